@@ -0,0 +1,184 @@
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <thread>
+#include <unistd.h>
+
+#include <argparse/argparse.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+
+namespace bench {
+
+static vector<unique_ptr<Benchmark>> &registry() {
+    static vector<unique_ptr<Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+Benchmark *registerBenchmark(const string &name, function<void(State &)> fn) {
+    registry().push_back(make_unique<Benchmark>(name, move(fn)));
+    return registry().back().get();
+}
+
+} // namespace bench
+
+namespace {
+
+struct Result {
+    string name;
+    size_t iterations;
+    double seconds;
+    size_t items;
+    vector<pair<string, double>> counters;
+};
+
+double timeRun(const bench::Benchmark &benchmark, size_t iterations, long arg, size_t &items,
+    vector<pair<string, double>> &counters) {
+    bench::State state(iterations, arg);
+    auto start= chrono::steady_clock::now();
+
+    benchmark.run(state);
+
+    auto stop= chrono::steady_clock::now();
+    items= state.itemsProcessed();
+    counters= state.counters();
+
+    // a benchmark without the state loop is timed as a whole
+    return state.timed() ? state.seconds() : chrono::duration<double>(stop - start).count();
+}
+
+// Grows the iteration count until a run lasts at least minTime, like
+// Google Benchmark's iteration estimate.
+Result measure(const bench::Benchmark &benchmark, const string &name, long arg, double minTime) {
+    size_t iterations= 1;
+    size_t items;
+    vector<pair<string, double>> counters;
+    double seconds= timeRun(benchmark, iterations, arg, items, counters);
+
+    while (seconds < minTime && iterations < (size_t(1) << 40)) {
+        double scale= seconds > 0.0 ? 1.4 * minTime / seconds : 100.0;
+        iterations= max(iterations + 1, static_cast<size_t>(iterations * min(scale, 100.0)));
+        seconds= timeRun(benchmark, iterations, arg, items, counters);
+    }
+
+    return Result{name, iterations, seconds, items, counters};
+}
+
+string jsonEscape(const string &s) {
+    string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out+= '\\';
+        out+= c;
+    }
+    return out;
+}
+
+void writeJson(const string &path, const vector<Result> &results) {
+    ofstream out(path);
+    if (!out)
+        throw runtime_error("cannot open " + path);
+
+    char host[256]= "";
+    gethostname(host, sizeof(host) - 1);
+
+    char date[64];
+    time_t now= time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    out << "{\n";
+    out << "  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"host_name\": \"" << jsonEscape(host) << "\",\n";
+    out << "    \"num_cpus\": " << thread::hardware_concurrency() << "\n";
+    out << "  },\n";
+    out << "  \"benchmarks\": [\n";
+
+    for (size_t i= 0; i < results.size(); ++i) {
+        const Result &r= results[i];
+        char line[512];
+
+        snprintf(line, sizeof(line),
+            "    {\"name\": \"%s\", \"iterations\": %zu, \"real_time\": %.3f, \"time_unit\": \"ns\", "
+            "\"ns_per_sample\": %.4f, \"items_per_second\": %.6g",
+            jsonEscape(r.name).c_str(), r.iterations, r.seconds * 1e9 / r.iterations,
+            r.items ? r.seconds * 1e9 / r.items : 0.0, r.items ? r.items / r.seconds : 0.0);
+        out << line;
+
+        for (const auto &[counter, value] : r.counters) {
+            snprintf(line, sizeof(line), ", \"%s\": %.6g", jsonEscape(counter).c_str(), value);
+            out << line;
+        }
+
+        out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args("clbench");
+    args.add_argument("--filter").default_value(string(".*")).help("regex selecting the benchmarks to run");
+    args.add_argument("--min_time").default_value(0.2).help("minimum seconds per benchmark").scan<'g', double>();
+    args.add_argument("--json").help("also write the results to this JSON file");
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &e) {
+        cerr << e.what() << endl << args << endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto json= args.present<string>("json");
+    const auto minTime= args.get<double>("min_time");
+    vector<Result> results;
+
+    try {
+        regex filter(args.get<string>("filter"));
+
+        printf("%-40s %14s %12s %12s %14s\n", "Benchmark", "Iterations", "ns/iter", "ns/sample", "samples/s");
+
+        for (const auto &benchmark : bench::registry()) {
+            vector<long> argList= benchmark->args();
+            if (argList.empty())
+                argList.push_back(0);
+
+            for (long arg : argList) {
+                string name= benchmark->name();
+                if (!benchmark->args().empty())
+                    name+= "/" + to_string(arg);
+
+                if (!regex_search(name, filter))
+                    continue;
+
+                Result r= measure(*benchmark, name, arg, minTime);
+                results.push_back(r);
+
+                printf("%-40s %14zu %12.1f %12.3f %14.4g", r.name.c_str(), r.iterations, r.seconds * 1e9 / r.iterations,
+                    r.items ? r.seconds * 1e9 / r.items : 0.0, r.items ? r.items / r.seconds : 0.0);
+                for (const auto &[counter, value] : r.counters)
+                    printf(" %s=%.3g", counter.c_str(), value);
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+
+        if (json)
+            writeJson(*json, results);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
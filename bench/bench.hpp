@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// A small stand-in for Google Benchmark: benchmarks register themselves at
+// static-init time, run until a minimum time has elapsed, and report
+// ns/sample and samples/sec to the console and optionally as JSON (same
+// top-level layout as Google Benchmark's --benchmark_out). Named counters,
+// such as an error measured alongside the timing, follow on the same line.
+//
+//   static void BM_Thing(bench::State &state) {
+//       for (auto _ : state)
+//           work(state.arg());
+//       state.setItemsProcessed(state.iterations() * samplesPerIteration);
+//   }
+//   BENCHMARK(BM_Thing)->arg(6)->arg(12);
+namespace bench {
+
+class State {
+public:
+    State(size_t iterations, long arg)
+        : iterations_(iterations), arg_(arg), items_(0), timed_(false) {}
+
+    // The clock runs from begin() until the loop ends, as in Google
+    // Benchmark, so setup and teardown around the loop are not measured.
+    struct Iterator {
+        size_t remaining;
+        State *state;
+
+        bool operator!=(const Iterator &) const {
+            if (remaining != 0)
+                return true;
+
+            if (state)
+                state->stop();
+            return false;
+        }
+
+        Iterator &operator++() {
+            --remaining;
+            return *this;
+        }
+
+        // non-trivial so `for (auto _ : state)` raises no unused warning
+        struct Value {
+            ~Value() {}
+        };
+
+        Value operator*() const {
+            return Value();
+        }
+    };
+
+    Iterator begin() {
+        start_= chrono::steady_clock::now();
+        return Iterator{iterations_, this};
+    }
+
+    Iterator end() {
+        return Iterator{0, nullptr};
+    }
+
+    size_t iterations() const {
+        return iterations_;
+    }
+
+    long arg() const {
+        return arg_;
+    }
+
+    // samples handled by the whole run, for ns/sample and samples/sec
+    void setItemsProcessed(size_t items) {
+        items_= items;
+    }
+
+    size_t itemsProcessed() const {
+        return items_;
+    }
+
+    // reported as is, like Google Benchmark's user counters
+    void setCounter(const string &name, double value) {
+        counters_.emplace_back(name, value);
+    }
+
+    const vector<pair<string, double>> &counters() const {
+        return counters_;
+    }
+
+    // whether the loop ran to its end, and the seconds it took
+    bool timed() const {
+        return timed_;
+    }
+
+    double seconds() const {
+        return chrono::duration<double>(stop_ - start_).count();
+    }
+
+private:
+    void stop() {
+        stop_= chrono::steady_clock::now();
+        timed_= true;
+    }
+
+    size_t iterations_;
+    long arg_;
+    size_t items_;
+    vector<pair<string, double>> counters_;
+    bool timed_;
+    chrono::steady_clock::time_point start_, stop_;
+};
+
+class Benchmark {
+public:
+    Benchmark(const string &name, function<void(State &)> fn)
+        : name_(name), fn_(move(fn)) {}
+
+    Benchmark *arg(long value) {
+        args_.push_back(value);
+        return this;
+    }
+
+    const string &name() const {
+        return name_;
+    }
+
+    const vector<long> &args() const {
+        return args_;
+    }
+
+    void run(State &state) const {
+        fn_(state);
+    }
+
+private:
+    string name_;
+    function<void(State &)> fn_;
+    vector<long> args_;
+};
+
+Benchmark *registerBenchmark(const string &name, function<void(State &)> fn);
+
+// Keeps the compiler from discarding a computed value.
+template<typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Forces pending stores to buffers to be treated as observed.
+inline void clobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+} // namespace bench
+
+#define BENCH_CONCAT2(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT2(a, b)
+#define BENCHMARK(fn) \
+    static bench::Benchmark *BENCH_CONCAT(bench_, __LINE__) [[maybe_unused]]= bench::registerBenchmark(#fn, fn)
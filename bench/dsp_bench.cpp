@@ -0,0 +1,254 @@
+#include <cmath>
+#include <vector>
+
+#include "bench.hpp"
+#include "env.hpp"
+#include "filter.hpp"
+#include "filtercascade.hpp"
+#include "vco.hpp"
+
+using namespace std;
+
+namespace {
+
+const size_t blockSize= 256;
+const double sampleRate= 48000.0;
+
+// slow upward sweep so the oscillators see a range of frequencies
+vector<double> controlVoltages() {
+    vector<double> cv(blockSize);
+    for (size_t i= 0; i < blockSize; ++i)
+        cv[i]= 1.0 + i / double(blockSize);
+    return cv;
+}
+
+void BM_VcoSine(bench::State &state) {
+    Vco vco(sampleRate, 440.0, 1.0);
+    vector<double> cv= controlVoltages();
+
+    for (auto _ : state)
+        for (double v : cv)
+            bench::doNotOptimize(vco.generateSineWave(v));
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_VcoSine);
+
+void BM_VcoTriangle(bench::State &state) {
+    Vco vco(sampleRate, 440.0, 1.0);
+    vector<double> cv= controlVoltages();
+
+    for (auto _ : state)
+        for (double v : cv)
+            bench::doNotOptimize(vco.generateTriangleWave(v));
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_VcoTriangle);
+
+void BM_VcoSquare(bench::State &state) {
+    Vco vco(sampleRate, 440.0, 1.0);
+    vector<double> cv= controlVoltages();
+
+    for (auto _ : state)
+        for (double v : cv)
+            bench::doNotOptimize(vco.generateSquareWave(v));
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_VcoSquare);
+
+// block API per engine (arg: Vco::Engine), square wave
+void BM_VcoBlock(bench::State &state) {
+    Vco vco(sampleRate, 440.0, 1.0, static_cast<Vco::Engine>(state.arg()));
+    vector<double> cv= controlVoltages();
+    vector<double> out(blockSize);
+
+    for (auto _ : state) {
+        vco.generateWaveForm(cv.data(), out.data(), blockSize, Vco::WaveType::SQUARE);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_VcoBlock)->arg(static_cast<long>(Vco::Engine::NAIVE))->arg(static_cast<long>(Vco::Engine::WAVETABLE))
+    ->arg(static_cast<long>(Vco::Engine::POLYBLEP));
+
+// block API of the naive sine (arg: Precision), in blocks of Sample
+template<typename Sample>
+void vcoSineBlock(bench::State &state) {
+    BasicVco<Sample> vco(sampleRate, 440.0, 1.0, Vco::Engine::NAIVE, static_cast<Precision>(state.arg()));
+    vector<double> cv= controlVoltages();
+    vector<Sample> in(cv.begin(), cv.end());
+    vector<Sample> out(blockSize);
+
+    for (auto _ : state) {
+        vco.generateWaveForm(in.data(), out.data(), blockSize, Vco::WaveType::SINE);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+void BM_VcoSineBlock(bench::State &state) {
+    vcoSineBlock<double>(state);
+}
+BENCHMARK(BM_VcoSineBlock)->arg(static_cast<long>(Precision::LOW))->arg(static_cast<long>(Precision::HIGH))
+    ->arg(static_cast<long>(Precision::FULL));
+
+void BM_VcoSineBlockFloat(bench::State &state) {
+    vcoSineBlock<float>(state);
+}
+BENCHMARK(BM_VcoSineBlockFloat)->arg(static_cast<long>(Precision::LOW))->arg(static_cast<long>(Precision::HIGH))
+    ->arg(static_cast<long>(Precision::FULL));
+
+// arg: rolloff in dB/oct
+void BM_FilterSample(bench::State &state) {
+    Filter filter(sampleRate, Filter::Type::LOWPASS, 1000.0, state.arg());
+    vector<double> cv= controlVoltages();
+
+    for (auto _ : state)
+        for (double v : cv)
+            bench::doNotOptimize(filter.process(v));
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_FilterSample)->arg(6)->arg(12)->arg(18)->arg(24)->arg(48)->arg(96);
+
+template<typename Sample>
+void filterBlock(bench::State &state, double cutoff) {
+    BasicFilter<Sample> filter(sampleRate, Filter::Type::LOWPASS, cutoff, state.arg());
+    vector<double> cv= controlVoltages();
+    vector<Sample> in(cv.begin(), cv.end());
+    vector<Sample> out(blockSize);
+
+    for (auto _ : state) {
+        filter.process(in.data(), out.data(), blockSize);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+
+void BM_FilterBlock(bench::State &state) {
+    filterBlock<double>(state, 1000.0);
+}
+BENCHMARK(BM_FilterBlock)->arg(6)->arg(12)->arg(18)->arg(24)->arg(48)->arg(96);
+
+// a float cascade, and at 100 Hz one kept in double
+void BM_FilterBlockFloat(bench::State &state) {
+    filterBlock<float>(state, 1000.0);
+}
+BENCHMARK(BM_FilterBlockFloat)->arg(6)->arg(12)->arg(24)->arg(48)->arg(96);
+
+void BM_FilterBlockFloatLow(bench::State &state) {
+    filterBlock<float>(state, 100.0);
+}
+BENCHMARK(BM_FilterBlockFloatLow)->arg(24)->arg(96);
+
+// the same filters as FilterSample and FilterBlock, unrolled for their order
+void BM_FilterCascadeSample(bench::State &state) {
+    unique_ptr<Cascade> cascade= makeFilterCascade(sampleRate, Filter::Type::LOWPASS, 1000.0, state.arg());
+    vector<double> cv= controlVoltages();
+
+    for (auto _ : state)
+        for (double v : cv)
+            bench::doNotOptimize(cascade->process(v));
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_FilterCascadeSample)->arg(6)->arg(12)->arg(18)->arg(24)->arg(48)->arg(96);
+
+void BM_FilterCascadeBlock(bench::State &state) {
+    unique_ptr<Cascade> cascade= makeFilterCascade(sampleRate, Filter::Type::LOWPASS, 1000.0, state.arg());
+    vector<double> in= controlVoltages();
+    vector<double> out(blockSize);
+
+    for (auto _ : state) {
+        cascade->process(in.data(), out.data(), blockSize);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_FilterCascadeBlock)->arg(6)->arg(12)->arg(18)->arg(24)->arg(48)->arg(96);
+
+// arg: channels of a 48 dB/oct bank, one per lane
+template<typename Sample>
+void biquadBank(bench::State &state) {
+    size_t channels= state.arg();
+    vector<BasicBiquad<Sample>> sections;
+    for (const auto &bq : Filter(sampleRate, Filter::Type::LOWPASS, 1000.0, 48).sections())
+        sections.push_back(bq.template to<Sample>());
+
+    BasicBiquadBank<Sample> bank(sections, channels, detectSimd());
+    vector<double> cv= controlVoltages();
+    vector<Sample> block(blockSize * channels);
+    for (size_t i= 0; i < block.size(); ++i)
+        block[i]= cv[i / channels];
+
+    for (auto _ : state) {
+        bank.process(block.data(), block.data(), blockSize);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize * channels);
+}
+
+void BM_BiquadBank(bench::State &state) {
+    biquadBank<double>(state);
+}
+BENCHMARK(BM_BiquadBank)->arg(8)->arg(16);
+
+void BM_BiquadBankFloat(bench::State &state) {
+    biquadBank<float>(state);
+}
+BENCHMARK(BM_BiquadBankFloat)->arg(8)->arg(16);
+
+// the cutoff swept two octaves either side of 1 kHz, at a resonant Q
+void BM_FilterModulated(bench::State &state) {
+    Filter filter(sampleRate, Filter::Type::LOWPASS, 1000.0, state.arg());
+    vector<double> in= controlVoltages();
+    vector<double> cutoffCv(blockSize), q(blockSize, 4.0);
+    vector<double> out(blockSize);
+
+    for (size_t i= 0; i < blockSize; ++i)
+        cutoffCv[i]= 2.0 * sin(2.0 * M_PI * i / blockSize);
+
+    for (auto _ : state) {
+        filter.process(in.data(), cutoffCv.data(), q.data(), out.data(), blockSize);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_FilterModulated)->arg(6)->arg(12)->arg(24)->arg(48)->arg(96);
+
+// arg: Stage to hold the envelope in; the segment times are long enough
+// that no benchmark run leaves it
+void BM_AdsrUpdate(bench::State &state) {
+    Stage stage= static_cast<Stage>(state.arg());
+    float forever= 1e6f;
+    ADSR env(stage == Stage::Attack ? forever : 0.0f, stage == Stage::Decay ? forever : 0.0f, 0.7f,
+        forever, static_cast<int>(sampleRate));
+
+    if (stage != Stage::Idle) {
+        env.note_on();
+        if (stage != Stage::Attack)
+            env.update();
+        if (stage == Stage::Sustain || stage == Stage::Release)
+            env.update();
+        if (stage == Stage::Release)
+            env.note_off();
+    }
+
+    for (auto _ : state)
+        for (size_t i= 0; i < blockSize; ++i)
+            bench::doNotOptimize(env.update());
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_AdsrUpdate)->arg(static_cast<long>(Stage::Idle))->arg(static_cast<long>(Stage::Attack))
+    ->arg(static_cast<long>(Stage::Decay))->arg(static_cast<long>(Stage::Sustain))->arg(static_cast<long>(Stage::Release));
+
+} // namespace
@@ -0,0 +1,123 @@
+#include <cmath>
+#include <vector>
+
+#include "bench.hpp"
+#include "fastmath.hpp"
+
+using namespace std;
+
+// Each benchmark times one function of fastmath.hpp over a block of inputs
+// (arg: Precision; FULL is libm) and reports its largest error on that
+// block against the long double libm as max_error: absolute for sin and
+// cos, relative for tan and exp.
+namespace {
+
+const size_t blockSize= 4096;
+
+vector<double> inputs(double lowest, double highest) {
+    vector<double> x(blockSize);
+    for (size_t i= 0; i < blockSize; ++i)
+        x[i]= lowest + (highest - lowest) * (i + 0.5) / blockSize;
+    return x;
+}
+
+template<Precision P>
+double call(int function, double x) {
+    switch (function) {
+        case 0:
+            return fastmath::sin<P>(x);
+        case 1:
+            return fastmath::cos<P>(x);
+        case 2:
+            return fastmath::tan<P>(x);
+        default:
+            return fastmath::exp<P>(x);
+    }
+}
+
+double call(Precision precision, int function, double x) {
+    switch (precision) {
+        case Precision::LOW:
+            return call<Precision::LOW>(function, x);
+        case Precision::HIGH:
+            return call<Precision::HIGH>(function, x);
+        default:
+            return call<Precision::FULL>(function, x);
+    }
+}
+
+long double reference(int function, long double x) {
+    switch (function) {
+        case 0:
+            return sinl(x);
+        case 1:
+            return cosl(x);
+        case 2:
+            return tanl(x);
+        default:
+            return expl(x);
+    }
+}
+
+// the switches are resolved outside the timed loop, so each call is inlined
+template<Precision P, int F>
+void timeCalls(bench::State &state, const vector<double> &x) {
+    for (auto _ : state)
+        for (double v : x)
+            bench::doNotOptimize(call<P>(F, v));
+}
+
+template<int F>
+void run(bench::State &state, double lowest, double highest, bool relative) {
+    Precision precision= static_cast<Precision>(state.arg());
+    vector<double> x= inputs(lowest, highest);
+
+    switch (precision) {
+        case Precision::LOW:
+            timeCalls<Precision::LOW, F>(state, x);
+            break;
+        case Precision::HIGH:
+            timeCalls<Precision::HIGH, F>(state, x);
+            break;
+        default:
+            timeCalls<Precision::FULL, F>(state, x);
+            break;
+    }
+
+    double maxError= 0.0;
+    for (double v : x) {
+        long double exact= reference(F, v);
+        long double error= fabsl(call(precision, F, v) - exact);
+        maxError= max(maxError, static_cast<double>(relative ? error / fabsl(exact) : error));
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+    state.setCounter("max_error", maxError);
+}
+
+void BM_FastSin(bench::State &state) {
+    run<0>(state, -100.0, 100.0, false);
+}
+BENCHMARK(BM_FastSin)->arg(static_cast<long>(Precision::LOW))->arg(static_cast<long>(Precision::HIGH))
+    ->arg(static_cast<long>(Precision::FULL));
+
+void BM_FastCos(bench::State &state) {
+    run<1>(state, -100.0, 100.0, false);
+}
+BENCHMARK(BM_FastCos)->arg(static_cast<long>(Precision::LOW))->arg(static_cast<long>(Precision::HIGH))
+    ->arg(static_cast<long>(Precision::FULL));
+
+// up to 0.49 pi, the highest prewarped cutoff Filter uses
+void BM_FastTan(bench::State &state) {
+    run<2>(state, -1.54, 1.54, true);
+}
+BENCHMARK(BM_FastTan)->arg(static_cast<long>(Precision::LOW))->arg(static_cast<long>(Precision::HIGH))
+    ->arg(static_cast<long>(Precision::FULL));
+
+void BM_FastExp(bench::State &state) {
+    run<3>(state, -20.0, 20.0, true);
+}
+BENCHMARK(BM_FastExp)->arg(static_cast<long>(Precision::LOW))->arg(static_cast<long>(Precision::HIGH))
+    ->arg(static_cast<long>(Precision::FULL));
+
+} // namespace
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "bench.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+namespace {
+
+const size_t blockSize= 256;
+const size_t streamSamples= 1 << 16;
+
+vector<double> signal() {
+    vector<double> samples(streamSamples);
+    for (size_t i= 0; i < streamSamples; ++i)
+        samples[i]= 0.001 * static_cast<double>(i % 2000) - 1.0;
+    return samples;
+}
+
+// arg: Format; encodes into /dev/null so only formatting and write() count
+void BM_SampleWrite(bench::State &state) {
+    Format format= static_cast<Format>(state.arg());
+    int fd= open("/dev/null", O_WRONLY);
+    vector<double> samples= signal();
+
+    {
+        SampleWriter writer(fd, format, 48000.0);
+
+        for (auto _ : state)
+            for (size_t i= 0; i < streamSamples; i+= blockSize)
+                writer.write(samples.data() + i, blockSize);
+    }
+
+    close(fd);
+    state.setItemsProcessed(state.iterations() * streamSamples);
+}
+BENCHMARK(BM_SampleWrite)->arg(static_cast<long>(Format::TEXT))->arg(static_cast<long>(Format::RAW))
+    ->arg(static_cast<long>(Format::F32))->arg(static_cast<long>(Format::F64));
+
+// arg: Format; decodes a pre-encoded stream from a temporary file
+void BM_SampleRead(bench::State &state) {
+    Format format= static_cast<Format>(state.arg());
+    FILE *file= tmpfile();
+    int fd= fileno(file);
+    vector<double> samples= signal();
+    vector<double> block(blockSize);
+
+    {
+        SampleWriter writer(fd, format, 48000.0);
+        writer.write(samples.data(), samples.size());
+    }
+
+    for (auto _ : state) {
+        lseek(fd, 0, SEEK_SET);
+        SampleReader reader(fd, format);
+
+        while (reader.read(block.data(), block.size()) > 0)
+            bench::clobberMemory();
+    }
+
+    fclose(file);
+    state.setItemsProcessed(state.iterations() * streamSamples);
+}
+BENCHMARK(BM_SampleRead)->arg(static_cast<long>(Format::TEXT))->arg(static_cast<long>(Format::RAW))
+    ->arg(static_cast<long>(Format::F32))->arg(static_cast<long>(Format::F64));
+
+// arg: 0 = f64 over a pipe, 1 = shared-memory ring; a producer thread
+// streams blocks to the measured consumer, as between two module processes
+void BM_Transport(bench::State &state) {
+    bool shm= state.arg() == 1;
+    string name= shm ? "bench-" + to_string(getpid()) : "";
+    int fds[2];
+
+    if (pipe(fds) < 0)
+        return;
+
+    vector<double> samples= signal();
+    vector<double> block(blockSize);
+    size_t total= state.iterations() * streamSamples;
+
+    thread producer([&]() {
+        {
+            SampleWriter writer(fds[1], Format::F64, 48000.0, 1, name);
+            for (size_t sent= 0; sent < total; sent+= blockSize) {
+                writer.write(samples.data() + sent % streamSamples, blockSize);
+                if (!shm)
+                    writer.flush();
+            }
+        }
+        close(fds[1]);
+    });
+
+    {
+        SampleReader reader(fds[0], Format::F64, name);
+
+        for (auto _ : state)
+            for (size_t received= 0; received < streamSamples; )
+                received+= reader.read(block.data(), min(block.size(), streamSamples - received));
+    }
+
+    producer.join();
+    close(fds[0]);
+    state.setItemsProcessed(total);
+}
+BENCHMARK(BM_Transport)->arg(0)->arg(1);
+
+// arg: Format; a constant CV written block by block as cv does, then read
+// back as samples (f32) or as runs (ctl)
+void BM_ControlStream(bench::State &state) {
+    Format format= static_cast<Format>(state.arg());
+    FILE *file= tmpfile();
+    int fd= fileno(file);
+    double voltage= 1.0;
+    vector<double> block(blockSize);
+    vector<ControlRun> runs(blockSize);
+
+    for (auto _ : state) {
+        ftruncate(fd, 0);
+        lseek(fd, 0, SEEK_SET);
+        {
+            SampleWriter writer(fd, format, 48000.0);
+            for (size_t i= 0; i < streamSamples; i+= blockSize)
+                writer.writeRun(&voltage, blockSize);
+        }
+
+        lseek(fd, 0, SEEK_SET);
+        SampleReader reader(fd, format);
+
+        if (format == Format::CTL) {
+            while (reader.readRuns(runs.data(), runs.size()) > 0)
+                bench::clobberMemory();
+        } else {
+            while (reader.read(block.data(), block.size()) > 0)
+                bench::clobberMemory();
+        }
+    }
+
+    fclose(file);
+    state.setItemsProcessed(state.iterations() * streamSamples);
+}
+BENCHMARK(BM_ControlStream)->arg(static_cast<long>(Format::F32))->arg(static_cast<long>(Format::CTL));
+
+} // namespace
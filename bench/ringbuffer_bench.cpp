@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <vector>
+
+#include "bench.hpp"
+#include "ringbuffer.hpp"
+
+using namespace std;
+
+namespace {
+
+const size_t blockSize= 256;
+
+// single-threaded push of a block followed by popping it back
+void BM_RingBufferPushPop(bench::State &state) {
+    RingBuffer<float> ring(4096);
+    float value= 0.0f;
+
+    for (auto _ : state) {
+        for (size_t i= 0; i < blockSize; ++i)
+            ring.push(static_cast<float>(i));
+        for (size_t i= 0; i < blockSize; ++i)
+            ring.pop(value);
+        bench::doNotOptimize(value);
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_RingBufferPushPop);
+
+// the same traffic through pushBlock/popBlock (two copies per call at most)
+void BM_RingBufferBlock(bench::State &state) {
+    RingBuffer<float> ring(4096);
+    vector<float> in(blockSize, 1.0f), out(blockSize);
+
+    for (auto _ : state) {
+        ring.pushBlock(in.data(), blockSize);
+        ring.popBlock(out.data(), blockSize);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_RingBufferBlock);
+
+// zero-copy: produce straight into the write spans, consume from the read spans
+void BM_RingBufferSpans(bench::State &state) {
+    RingBuffer<float> ring(4096);
+    float sum= 0.0f;
+
+    for (auto _ : state) {
+        auto [first, second]= ring.writeSpans();
+        size_t n= min(blockSize, first.size() + second.size());
+        for (size_t i= 0; i < n; ++i)
+            (i < first.size() ? first[i] : second[i - first.size()])= static_cast<float>(i);
+        ring.commitWrite(n);
+
+        auto [oldest, newest]= ring.readSpans();
+        for (float v : oldest)
+            sum+= v;
+        for (float v : newest)
+            sum+= v;
+        ring.commitRead(oldest.size() + newest.size());
+    }
+
+    bench::doNotOptimize(sum);
+    state.setItemsProcessed(state.iterations() * blockSize);
+}
+BENCHMARK(BM_RingBufferSpans);
+
+// arg: samples copied per call, out of a full ring (the scope's display read)
+void BM_RingBufferCopyFromTail(bench::State &state) {
+    size_t count= state.arg();
+    RingBuffer<float> ring(8 * count);
+    vector<float> out(count);
+
+    while (ring.push(1.0f))
+        ;
+
+    for (auto _ : state) {
+        ring.copyFromTail(count / 2, out.data(), count);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_RingBufferCopyFromTail)->arg(1024)->arg(16384);
+
+} // namespace
@@ -0,0 +1,316 @@
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "bench.hpp"
+#include "envelope.hpp"
+#include "fft.hpp"
+#include "rasterizer.hpp"
+#include "ringbuffer.hpp"
+#include "spectrum.hpp"
+#include "trigger.hpp"
+
+using namespace std;
+
+namespace {
+
+const size_t windowWidth= 800;
+const int windowHeight= 400;
+const size_t blockSize= 256;
+const size_t displaySize= 4800;
+
+vector<float> frame(size_t count) {
+    vector<float> samples(count);
+    for (size_t i= 0; i < count; ++i)
+        samples[i]= sin(0.01 * i) + 0.1f * sin(0.7 * i);
+    return samples;
+}
+
+// arg: frame size; one pass building the min/max/RMS pyramid
+void BM_EnvelopeSet(bench::State &state) {
+    vector<float> samples= frame(state.arg());
+    Envelope envelope;
+
+    for (auto _ : state) {
+        envelope.set(samples.data(), samples.size());
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_EnvelopeSet)->arg(4800)->arg(48000)->arg(480000);
+
+// arg: frame size; 800 columns from the pyramid (items are columns)
+void BM_EnvelopeColumns(bench::State &state) {
+    vector<float> samples= frame(state.arg());
+    vector<Envelope::Column> columns(windowWidth);
+    Envelope envelope;
+    envelope.set(samples.data(), samples.size());
+
+    for (auto _ : state) {
+        envelope.columns(0, samples.size(), columns.data(), windowWidth);
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * windowWidth);
+}
+BENCHMARK(BM_EnvelopeColumns)->arg(4800)->arg(48000)->arg(480000);
+
+// arg: frame size; the same 800 columns by scanning the raw samples
+void BM_EnvelopeRescan(bench::State &state) {
+    vector<float> samples= frame(state.arg());
+    vector<Envelope::Column> columns(windowWidth);
+    size_t count= samples.size();
+
+    for (auto _ : state) {
+        for (size_t x= 0; x < windowWidth; ++x) {
+            size_t a= x * count / windowWidth;
+            size_t b= min((x + 1) * count / windowWidth + 1, count);
+            float low= samples[a], high= samples[a];
+            double squares= 0.0;
+
+            for (size_t i= a; i < b; ++i) {
+                low= min(low, samples[i]);
+                high= max(high, samples[i]);
+                squares+= static_cast<double>(samples[i]) * samples[i];
+            }
+
+            columns[x]= { low, high, static_cast<float>(sqrt(squares / (b - a))) };
+        }
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * windowWidth);
+}
+BENCHMARK(BM_EnvelopeRescan)->arg(4800)->arg(48000)->arg(480000);
+
+// The scope's former trigger search, with its empty-buffer underflow fixed:
+// walk back from `offset` samples before the head to the newest rising
+// crossing.
+optional<size_t> rescan(const RingBuffer<float> &ring, size_t offset, float threshold) {
+    size_t size= ring.size();
+    if (size < offset + 2)
+        return nullopt;
+
+    const auto &data= ring.data();
+    size_t mask= ring.capacity() - 1;
+    size_t current= (ring.head() - offset - 1) & mask;
+
+    for (size_t i= offset + 1; i < size; ++i) {
+        size_t prev= (current - 1) & mask;
+        if (data[prev] < threshold && data[current] >= threshold)
+            return i;
+        current= prev;
+    }
+
+    return nullopt;
+}
+
+// a sine of period arg samples, in blocks
+vector<float> periodic(size_t period) {
+    vector<float> samples(1 << 16);
+    for (size_t i= 0; i < samples.size(); ++i)
+        samples[i]= sin(2.0 * M_PI * i / period);
+    return samples;
+}
+
+// arg: signal period; per block, the newest trigger with half a display
+// after it, found by walking back through the ring
+void BM_TriggerRescan(bench::State &state) {
+    vector<float> samples= periodic(state.arg());
+    RingBuffer<float> ring(displaySize * 4);
+
+    for (auto _ : state) {
+        for (size_t i= 0; i < samples.size(); i+= blockSize) {
+            size_t free= ring.capacity() - ring.size();
+            if (blockSize > free)
+                ring.commitRead(blockSize - free);
+            ring.pushBlock(samples.data() + i, blockSize);
+            bench::doNotOptimize(rescan(ring, displaySize / 2, 0.5f));
+        }
+    }
+
+    state.setItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_TriggerRescan)->arg(480)->arg(48000);
+
+// arg: signal period; the same query answered by the streaming detector
+void BM_TriggerIncremental(bench::State &state) {
+    vector<float> samples= periodic(state.arg());
+    Trigger trigger(0.5f, 0.0f, Trigger::Edge::RISING, 0, displaySize);
+
+    for (auto _ : state) {
+        for (size_t i= 0; i < samples.size(); i+= blockSize) {
+            trigger.process(samples.data() + i, blockSize);
+            bench::doNotOptimize(trigger.latest(trigger.position() - displaySize / 2));
+        }
+    }
+
+    state.setItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_TriggerIncremental)->arg(480)->arg(48000);
+
+// arg channels of 800 columns each, phase-shifted so the traces differ
+vector<vector<Envelope::Column>> traces(size_t channels) {
+    vector<vector<Envelope::Column>> columns(channels, vector<Envelope::Column>(windowWidth));
+    vector<float> samples= frame(displaySize + channels * 100);
+    Envelope envelope;
+
+    for (size_t c= 0; c < channels; ++c) {
+        envelope.set(samples.data() + c * 100, displaySize);
+        envelope.columns(0, displaySize, columns[c].data(), windowWidth);
+    }
+    return columns;
+}
+
+// arg: channels; the scope's former drawing, each trace's column spans
+// written straight into the framebuffer (items are channel frames)
+void BM_RasterizeColumns(bench::State &state) {
+    auto columns= traces(state.arg());
+    vector<uint32_t> pixels(windowWidth * windowHeight);
+    float yCenter= windowHeight / 2.0f;
+
+    auto toY= [&](float v) {
+        return clamp(static_cast<int>(yCenter - (v / 1.5f) * yCenter), 0, windowHeight - 1);
+    };
+
+    for (auto _ : state) {
+        fill(pixels.begin(), pixels.end(), 0);
+        for (size_t c= 0; c < columns.size(); ++c) {
+            for (size_t x= 0; x < windowWidth; ++x) {
+                for (int y= toY(columns[c][x].max); y <= toY(columns[c][x].min); ++y)
+                    pixels[y * windowWidth + x]= 0x00FF00;
+                for (int y= toY(columns[c][x].rms); y <= toY(-columns[c][x].rms); ++y)
+                    pixels[y * windowWidth + x]= 0xA0FFA0;
+            }
+        }
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * columns.size());
+}
+BENCHMARK(BM_RasterizeColumns)->arg(1)->arg(4)->arg(8);
+
+// arg: channels; the same frame composed row by row
+void BM_Rasterize(bench::State &state) {
+    auto columns= traces(state.arg());
+    vector<uint32_t> pixels(windowWidth * windowHeight);
+    Rasterizer rasterizer(windowWidth, windowHeight);
+
+    for (auto _ : state) {
+        rasterizer.clear();
+        for (size_t c= 0; c < columns.size(); ++c)
+            rasterizer.addTrace(columns[c].data(), 1.5f, 0x00FF00, true);
+
+        for (int y= 0; y < windowHeight; ++y) {
+            uint32_t *row= pixels.data() + y * windowWidth;
+            fill(row, row + windowWidth, 0);
+            rasterizer.drawRow(y, row);
+        }
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * columns.size());
+}
+BENCHMARK(BM_Rasterize)->arg(1)->arg(4)->arg(8);
+
+// A frame of the scope's redraw in a width x height framebuffer that keeps
+// the previous frame: one thin sine trace without RMS band, amplitude of
+// full scale, alternating between two phases. arg: 0 redraws every row,
+// as the scope did before, 1 composes the rows the old and new traces
+// touch, 2 rewrites only the pixels under them with updateColumns(), which
+// drawFrame() picks when they are under an eighth of those rows' pixels.
+// The counter share is that fraction. Items are frames.
+void rasterizeUpdate(bench::State &state, size_t width, int height, float amplitude) {
+    vector<vector<Envelope::Column>> columns(2, vector<Envelope::Column>(width));
+    vector<float> samples(displaySize + 100);
+    Envelope envelope;
+
+    for (size_t i= 0; i < samples.size(); ++i)
+        samples[i]= amplitude * sin(2.0 * M_PI * i / displaySize);
+    for (size_t c= 0; c < columns.size(); ++c) {
+        envelope.set(samples.data() + c * 100, displaySize);
+        envelope.columns(0, displaySize, columns[c].data(), width);
+    }
+
+    vector<uint32_t> pixels(width * height, 0);
+    vector<uint32_t> blank(width, 0);
+    vector<const uint32_t *> background(height, blank.data());
+    Rasterizer rasterizer(width, height);
+    size_t frame= 0;
+    double share= 0.0;
+
+    for (auto _ : state) {
+        rasterizer.clear();
+        rasterizer.addTrace(columns[frame++ % 2].data(), 1.5f, 0x00FF00, false);
+
+        int first= state.arg() == 0 ? 0 : rasterizer.firstRow();
+        int last= state.arg() == 0 ? height - 1 : rasterizer.lastRow();
+        size_t rowPixels= static_cast<size_t>(max(last - first + 1, 0)) * width;
+        share= rowPixels ? double(rasterizer.coverage()) / rowPixels : 0.0;
+
+        if (state.arg() == 2) {
+            rasterizer.updateColumns(pixels.data(), background.data());
+        } else {
+            for (int y= first; y <= last; ++y) {
+                uint32_t *row= pixels.data() + static_cast<size_t>(y) * width;
+                memcpy(row, background[y], width * sizeof(uint32_t));
+                rasterizer.drawRow(y, row);
+            }
+        }
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations());
+    state.setCounter("share", share);
+}
+
+void BM_RasterizeUpdate(bench::State &state) {
+    rasterizeUpdate(state, windowWidth, windowHeight, 1.0f);
+}
+BENCHMARK(BM_RasterizeUpdate)->arg(0)->arg(1)->arg(2);
+
+void BM_RasterizeUpdate4K(bench::State &state) {
+    rasterizeUpdate(state, 3840, 2160, 1.0f);
+}
+BENCHMARK(BM_RasterizeUpdate4K)->arg(0)->arg(1)->arg(2);
+
+// a tenth of full scale: the band of rows shrinks with the trace
+void BM_RasterizeUpdate4KSmall(bench::State &state) {
+    rasterizeUpdate(state, 3840, 2160, 0.1f);
+}
+BENCHMARK(BM_RasterizeUpdate4KSmall)->arg(0)->arg(1)->arg(2);
+
+// arg: FFT size; one real transform (items are input samples)
+void BM_RealFft(bench::State &state) {
+    vector<float> samples= frame(state.arg());
+    Fft fft(state.arg());
+    vector<float> re(fft.bins()), im(fft.bins());
+
+    for (auto _ : state) {
+        fft.forward(samples.data(), re.data(), im.data());
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_RealFft)->arg(1024)->arg(8192)->arg(65536);
+
+// arg: FFT size; window, transform, averaging and dB conversion of a
+// frame. At 50% overlap every input sample is analysed twice, so keeping
+// up with 192 kHz takes less than 2600 ns/sample here.
+void BM_Spectrum(bench::State &state) {
+    vector<float> samples= frame(state.arg());
+    Spectrum spectrum(state.arg(), Spectrum::Window::HANN, Spectrum::Averaging::EXPONENTIAL, 0.8f);
+
+    for (auto _ : state) {
+        spectrum.process(samples.data());
+        bench::clobberMemory();
+    }
+
+    state.setItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_Spectrum)->arg(1024)->arg(8192)->arg(65536);
+
+} // namespace
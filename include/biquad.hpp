@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Instruction sets the biquad engine dispatches to at runtime.
+enum class SimdLevel { SCALAR, SSE2, AVX2, AVX512 };
+
+SimdLevel detectSimd();
+bool simdSupported(SimdLevel level);
+// "auto" resolves to detectSimd(); throws for unknown or unsupported levels
+SimdLevel parseSimdLevel(const string &s);
+const char *simdLevelName(SimdLevel level);
+
+// Second-order section, transposed direct form II. T is double or float:
+// float sections take twice the lanes per vector, but their poles move
+// with the rounding of the coefficients, which grows sharply as the
+// cutoff falls (see BasicFilter).
+template<typename T>
+struct BasicBiquad {
+    T b0, b1, b2, a1, a2;
+    T z1{0.0}, z2{0.0};
+
+    T process(T x);
+    // block version; in and out may point to the same buffer
+    void process(const T *in, T *out, size_t n);
+
+    // the same section in another sample type
+    template<typename U>
+    BasicBiquad<U> to() const {
+        return { U(b0), U(b1), U(b2), U(a1), U(a2), U(z1), U(z2) };
+    }
+};
+
+typedef BasicBiquad<double> Biquad;
+
+// Runs a cascade of biquads over one channel; in and out may alias.
+//
+// The vector levels pipeline the stages across lanes: on every step lane k
+// filters the sample that lane k-1 produced on the previous step, so a
+// 4-lane group advances four stages per step. The first and last steps of
+// a block are masked so block boundaries behave exactly like the scalar
+// cascade. Each lane performs the scalar operations in the scalar order,
+// so with the build's -ffp-contract=off the output is bit-identical to
+// BasicBiquad::process at every level. A float cascade fills twice the
+// lanes: eight stages per AVX2 group instead of four. A level wider than
+// the cascade steps down to the narrowest one that holds every stage.
+template<typename T>
+void processCascade(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n, SimdLevel level);
+template<typename T>
+void processCascade(vector<BasicBiquad<T>> &stages, const T *in, T *out, size_t n, SimdLevel level);
+
+// The same cascade applied to several independent channels of interleaved
+// frames, one channel per lane. Matches per-channel processCascade exactly.
+template<typename T>
+class BasicBiquadBank {
+public:
+    BasicBiquadBank(const vector<BasicBiquad<T>> &stages, size_t channels, SimdLevel level);
+
+    // in and out hold frames * channels() interleaved samples and may alias
+    void process(const T *in, T *out, size_t frames);
+
+    // returns one channel's state to what the bank started with
+    void reset(size_t channel);
+
+    size_t channels() const {
+        return channels_;
+    }
+
+private:
+    vector<BasicBiquad<T>> stages_;
+    size_t channels_;
+    SimdLevel level_;
+    vector<T> z1_;     // [stage * channels_ + channel]
+    vector<T> z2_;
+};
+
+typedef BasicBiquadBank<double> BiquadBank;
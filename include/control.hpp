@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+using namespace std;
+
+// Control-rate signals: CV that changes at most once per control period
+// and is otherwise "constant until further notice". A CTL stream carries
+// them as runs, so a static patch costs one run per block rather than a
+// sample per sample.
+static constexpr size_t controlPeriod= 64;
+
+// a value held for a number of frames
+struct ControlRun {
+    size_t frames;
+    double value;
+};
+
+// Follows a held control value: each new value is reached by a linear ramp
+// over one control period, so a stepped control signal does not click.
+class ControlRamp {
+public:
+    // sets the value to ramp to; the first value is taken as is
+    void set(double target) {
+        if (!started_) {
+            current_= target_= target;
+            left_= 0;
+            started_= true;
+        } else if (target != target_) {
+            step_= (target - current_) / controlPeriod;
+            target_= target;
+            left_= controlPeriod;
+        }
+    }
+
+    bool settled() const {
+        return left_ == 0;
+    }
+
+    // the value for the next frame
+    double next() {
+        if (left_ > 0)
+            current_= (--left_ == 0) ? target_ : current_ + step_;
+        return current_;
+    }
+
+private:
+    bool started_= false;
+    double current_= 0.0;
+    double target_= 0.0;
+    double step_= 0.0;
+    size_t left_= 0;
+};
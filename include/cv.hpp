@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstddef>
+
+class SampleWriter;
+class Pacer;
+
 class Cv {
 public:
     Cv(double sampleRate,  double amplitude);
-    void process(double duration);
+    void process(double *out, size_t n);
+    void process(double duration, SampleWriter &writer, Pacer &pacer, size_t blockSize);
 private:
     double sampleRate_;
     double amplitude_;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 enum class Stage {
     Idle,
     Attack,
@@ -18,9 +20,18 @@ struct ADSR {
 
     float level= 0.0f;
     Stage stage= Stage::Idle;
+    bool gate= false;
 
     ADSR(float a, float d, float s, float r, int sampleRate);
     void note_on();
     void note_off();
     float update();
+    // block version: gate edges (> 0.5) trigger note_on/note_off. The
+    // envelope runs in float either way; Sample (double or float) is only
+    // the blocks' type.
+    template<typename Sample>
+    void process(const Sample *gates, Sample *out, size_t n);
+    // control-rate version: gateVoltage is held for the n samples
+    template<typename Sample>
+    void process(double gateVoltage, Sample *out, size_t n);
 };
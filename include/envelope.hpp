@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// Min/max/RMS envelope of a frame of samples, for drawing it at any width.
+//
+// set() builds a pyramid: level k holds the min, max and sum of squares of
+// every aligned run of 2^k samples, each level reduced from the one below,
+// so building costs about one pass over the frame. A range query then
+// combines at most two nodes per level, so an envelope per pixel column
+// costs O(width * log(frame)) however many samples each column spans, and
+// redrawing the same frame at another zoom never touches the raw samples.
+class Envelope {
+public:
+    struct Column {
+        float min;
+        float max;
+        float rms;
+    };
+
+    void set(const float *samples, size_t count);
+
+    size_t size() const {
+        return samples_.size();
+    }
+
+    // envelope of samples [first, last); last > first
+    Column range(size_t first, size_t last) const;
+
+    // Splits samples [first, first + count) into width columns. Each
+    // column also takes the first sample of the next, so neighbouring
+    // columns join up when zoomed in past one sample per column.
+    void columns(size_t first, size_t count, Column *out, size_t width) const;
+
+private:
+    struct Level {
+        vector<float> min;
+        vector<float> max;
+        vector<double> squares;
+    };
+
+    vector<float> samples_;     // level 0
+    vector<Level> levels_;      // levels_[k] covers runs of 2^(k+1) samples
+};
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+using namespace std;
+
+// Accuracy tiers of the approximations below. LOW keeps sin and cos within
+// 1.1e-4 of libm and exp within 7.5e-5 (relative), HIGH within 9.4e-7 and
+// 7.5e-8; tan, a ratio of two sines, doubles the relative error of its
+// tier. FULL calls libm.
+enum class Precision { LOW, HIGH, FULL };
+
+// throws for anything but "low", "high" or "full"
+Precision parsePrecision(const string &s);
+const char *precisionName(Precision precision);
+
+// Branch-free sin, cos, tan and exp. Each takes a double or float, or a GCC
+// vector of either, through references, as vectors wider than the target's
+// registers cannot be passed by value, so a kernel can evaluate a whole
+// vector of lanes at once; the scalar overloads return their result. FULL
+// falls back to libm lane by lane. Float evaluates the same polynomials in
+// twice the lanes; its rounding adds up to 2e-7 to the errors above, and
+// the argument of sin, cos and tan should stay within a few thousand turns.
+//
+// sin, cos and tan reduce x by the nearest multiple k of pi, with pi split
+// in two so k * pi is exact for |x| < 2^29 pi, and evaluate a minimax odd
+// polynomial for sin on [-pi/2, pi/2]; cos and tan take the sine of the
+// complementary angle, which keeps their relative error near their zeros
+// and poles. exp splits off a power of two the same way and builds it
+// straight into the exponent bits. Rounding to the nearest integer adds
+// and subtracts 1.5 * 2^52, which the build's strict floating point keeps.
+// Without contraction into FMAs, a lane of a vector gives the same bits as
+// the double overload.
+namespace fastmath {
+
+namespace detail {
+
+// the lanes' type of T: T itself, or the element of a vector
+template<typename T, typename= void>
+struct ElementOf {
+    typedef T type;
+};
+
+template<typename T>
+struct ElementOf<T, void_t<decltype(declval<T>()[0])>> {
+    typedef remove_cvref_t<decltype(declval<T>()[0])> type;
+};
+
+template<typename T>
+using Element= typename ElementOf<T>::type;
+
+// the integer lanes matching T
+template<typename T>
+using Bits= conditional_t<is_same_v<T, double>, int64_t,
+    conditional_t<is_same_v<T, float>, int32_t, decltype(T{} < T{})>>;
+
+// The layout of each element type. Rounding to the nearest integer adds and
+// subtracts 1.5 * 2^mantissa. The high parts of pi and ln 2 keep few
+// enough bits that k times them is exact.
+template<typename E>
+struct Layout;
+
+template<>
+struct Layout<double> {
+    static constexpr int mantissa= 52;
+    static constexpr int bias= 1023;
+    static constexpr int64_t signBit= INT64_MIN;
+    static constexpr double roundShift= 0x1.8p52;
+
+    static constexpr double piHi= 3.1415927410125732422;        // pi rounded to float
+    static constexpr double piLo= -8.7422780003724853329e-08;
+    static constexpr double ln2Hi= 6.93147180369123816490e-01;  // 32 significant bits
+    static constexpr double ln2Lo= 1.90821492927058770002e-10;
+
+    // where exp(x) is a normal number
+    static constexpr double expLowest= -708.0;
+    static constexpr double expHighest= 709.0;
+};
+
+template<>
+struct Layout<float> {
+    static constexpr int mantissa= 23;
+    static constexpr int bias= 127;
+    static constexpr int32_t signBit= INT32_MIN;
+    static constexpr float roundShift= 0x1.8p23f;
+
+    static constexpr float piHi= 3.140625f;                     // 8 significant bits
+    static constexpr float piLo= 9.67653589793e-04f;
+    static constexpr float ln2Hi= 0.693359375f;                 // 9 significant bits
+    static constexpr float ln2Lo= -2.12194440e-04f;
+
+    static constexpr float expLowest= -87.0f;
+    static constexpr float expHighest= 88.0f;
+};
+
+constexpr double invPi= 0.31830988618379067154;
+constexpr double halfPi= 1.5707963267948966192;
+constexpr double log2e= 1.4426950408889634074;
+
+template<typename To, typename From>
+[[gnu::always_inline]] inline void castBits(const From &from, To &to)
+{
+    static_assert(sizeof(To) == sizeof(From));
+    memcpy(&to, &from, sizeof(to));
+}
+
+template<typename T>
+[[gnu::always_inline]] inline void perLane(const T &x, T &y, double (*f)(double))
+{
+    if constexpr (is_same_v<T, Element<T>>) {
+        y= f(x);
+    } else {
+        for (size_t i= 0; i < sizeof(T) / sizeof(Element<T>); ++i)
+            y[i]= f(x[i]);
+    }
+}
+
+// r = x - k pi for the nearest integer k; odd is all zeros but the sign
+// bit, which is set when k is odd
+template<typename T>
+[[gnu::always_inline]] inline void reducePi(const T &x, T &r, Bits<T> &odd)
+{
+    using E= Element<T>;
+    using L= Layout<E>;
+
+    T shifted= x * E(invPi) + L::roundShift;
+    T k= shifted - L::roundShift;
+
+    castBits(shifted, odd);
+    odd<<= 8 * sizeof(E) - 1;
+    r= (x - k * L::piHi) - k * L::piLo;
+}
+
+// sin(r) for |r| <= pi/2: r times a polynomial in r^2, minimax in relative
+// error
+template<Precision P, typename T>
+[[gnu::always_inline]] inline void sinReduced(const T &r, T &y)
+{
+    using E= Element<T>;
+    T r2= r * r;
+
+    if constexpr (P == Precision::LOW)
+        y= r * (E(0.99989182125602549) + r2 * (E(-0.16596011654087381) + r2 * E(0.0076029033433095633)));
+    else
+        y= r * (E(0.99999906089899049) + r2 * (E(-0.16665554092764859) + r2 * (E(0.0083118998014602759)
+            + r2 * E(-0.00018488140290317374))));
+}
+
+// exp(r) for |r| <= ln(2) / 2, minimax in relative error
+template<Precision P, typename T>
+[[gnu::always_inline]] inline void expReduced(const T &r, T &y)
+{
+    using E= Element<T>;
+
+    if constexpr (P == Precision::LOW)
+        y= E(0.99992807354049562) + r * (E(1.000164185761095) + r * (E(0.50496326418224036)
+            + r * E(0.16566842347964411)));
+    else
+        y= E(1.0000000716546822) + r * (E(0.99999969199151661) + r * (E(0.49998894851221676)
+            + r * (E(0.16667574728754142) + r * (E(0.041915381991721089) + r * E(0.0082976550804586147)))));
+}
+
+template<typename T>
+[[gnu::always_inline]] inline void flipSign(T &x, const Bits<T> &sign)
+{
+    Bits<T> bits;
+    castBits(x, bits);
+    bits^= sign;
+    castBits(bits, x);
+}
+
+// clears the sign bit of x and returns it in sign
+template<typename T>
+[[gnu::always_inline]] inline void takeSign(T &x, Bits<T> &sign)
+{
+    castBits(x, sign);
+    sign&= Layout<Element<T>>::signBit;
+    flipSign(x, sign);
+}
+
+} // namespace detail
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline void sin(const T &x, T &y)
+{
+    if constexpr (P == Precision::FULL) {
+        detail::perLane(x, y, std::sin);
+    } else {
+        T r;
+        detail::Bits<T> odd;
+        detail::reducePi(x, r, odd);
+        detail::sinReduced<P>(r, y);
+        detail::flipSign(y, odd);
+    }
+}
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline void cos(const T &x, T &y)
+{
+    if constexpr (P == Precision::FULL) {
+        detail::perLane(x, y, std::cos);
+    } else {
+        T r;
+        detail::Bits<T> odd, sign;
+        detail::reducePi(x, r, odd);
+        detail::takeSign(r, sign);
+        detail::sinReduced<P>(detail::Element<T>(detail::halfPi) - r, y);
+        detail::flipSign(y, odd);
+    }
+}
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline void tan(const T &x, T &y)
+{
+    if constexpr (P == Precision::FULL) {
+        detail::perLane(x, y, std::tan);
+    } else {
+        T r, s, c;
+        detail::Bits<T> odd, sign;
+        detail::reducePi(x, r, odd);
+        detail::takeSign(r, sign);
+        detail::sinReduced<P>(r, s);
+        detail::sinReduced<P>(detail::Element<T>(detail::halfPi) - r, c);
+        y= s / c;
+        detail::flipSign(y, sign);
+    }
+}
+
+// x is clamped to [-708, 709] (float: [-87, 88]), the range where exp(x) is
+// a normal number
+template<Precision P, typename T>
+[[gnu::always_inline]] inline void exp(const T &x, T &y)
+{
+    if constexpr (P == Precision::FULL) {
+        detail::perLane(x, y, std::exp);
+    } else {
+        using E= detail::Element<T>;
+        using L= detail::Layout<E>;
+
+        const T lowest= T{} + L::expLowest;
+        const T highest= T{} + L::expHighest;
+        T clamped= x < lowest ? lowest : x;
+        clamped= clamped > highest ? highest : clamped;
+
+        T shifted= clamped * E(detail::log2e) + L::roundShift;
+        T k= shifted - L::roundShift;
+        T r= (clamped - k * L::ln2Hi) - k * L::ln2Lo;
+
+        // the low bits of shifted hold k; the rest shifts out
+        detail::Bits<T> exponent;
+        T scale;
+        detail::castBits(shifted, exponent);
+        exponent= (exponent + L::bias) << L::mantissa;
+        detail::castBits(exponent, scale);
+
+        detail::expReduced<P>(r, y);
+        y*= scale;
+    }
+}
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline enable_if_t<is_floating_point_v<T>, T> sin(T x)
+{
+    T y;
+    sin<P>(x, y);
+    return y;
+}
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline enable_if_t<is_floating_point_v<T>, T> cos(T x)
+{
+    T y;
+    cos<P>(x, y);
+    return y;
+}
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline enable_if_t<is_floating_point_v<T>, T> tan(T x)
+{
+    T y;
+    tan<P>(x, y);
+    return y;
+}
+
+template<Precision P, typename T>
+[[gnu::always_inline]] inline enable_if_t<is_floating_point_v<T>, T> exp(T x)
+{
+    T y;
+    exp<P>(x, y);
+    return y;
+}
+
+} // namespace fastmath
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Real-input FFT of a power-of-two size, with no dependencies.
+//
+// The N real samples are packed into N/2 complex ones (even samples as the
+// real parts, odd samples as the imaginary parts), transformed by an
+// iterative radix-2 FFT and then split into the N/2 + 1 bins of the real
+// spectrum, so a real transform costs about half a complex one. Twiddles
+// are stored stage after stage, so each butterfly loop reads them in order.
+class Fft {
+public:
+    // size is a power of two, at least 4
+    explicit Fft(size_t size);
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t bins() const {
+        return size_ / 2 + 1;
+    }
+
+    // bins() bins of the unnormalised DFT of size() samples
+    void forward(const float *in, float *re, float *im);
+
+private:
+    size_t size_;
+    vector<uint32_t> reverse_;      // bit reversal of the N/2-point transform
+    vector<float> twiddleRe_;       // exp(-2 pi i j / len) for every stage
+    vector<float> twiddleIm_;
+    vector<float> splitRe_;         // exp(-2 pi i k / N), k <= N/2
+    vector<float> splitIm_;
+    vector<float> workRe_;
+    vector<float> workIm_;
+};
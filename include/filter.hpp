@@ -1,39 +1,106 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <optional>
 #include <stdexcept>
 #include <string>
 
+#include "biquad.hpp"
+#include "fastmath.hpp"
+
 using namespace std;
 
-class Filter {
-public:
+// The parts of a filter shared by every sample type.
+struct FilterTypes {
     enum class Type { LOWPASS, HIGHPASS };
+};
+
+// Sample is the type of the signal, double or float. The coefficients are
+// always designed in double. A float filter runs its cascade in float,
+// twice the SIMD lanes, unless the cutoff is below narrowLowest * fs: the
+// poles of a low cutoff sit so close to 1 that float coefficients and
+// state would move them, and the cascade stays in double with the block
+// converted on the way in and out. The modulated version always runs in
+// double.
+template<typename Sample>
+class BasicFilter : public FilterTypes {
+public:
+    // precision: how closely the coefficient design follows libm
+    // (fastmath.hpp); the coefficients are only computed here
+    BasicFilter(double fs, Type type, double fc, int rolloff_db, SimdLevel simd= detectSimd(),
+        Precision precision= Precision::FULL);
+    Sample process(Sample x);
+    // block version; in and out may point to the same buffer
+    void process(const Sample *in, Sample *out, size_t n);
+
+    // Modulated version: the cutoff is fc shifted by cutoffCv[i] octaves
+    // (1 V/oct) and every second-order section has a Q of q[i]; either may
+    // be null to keep fc or the Butterworth Q. The sections run as
+    // state-variable filters, which take new coefficients every sample,
+    // and keep their own state: drive a filter through one version only.
+    void process(const Sample *in, const Sample *cutoffCv, const Sample *q, Sample *out, size_t n);
 
-    Filter(double fs, Type type, double fc, int rolloff_db);
-    double process(double x);
+    // The whole cascade as biquads (a first-order section becomes a biquad
+    // with b2 = a2 = 0), e.g. for a multi-channel BiquadBank. The converted
+    // section can differ from FirstOrder only in the sign of a zero output.
+    vector<Biquad> sections() const;
+
+    // whether the cascade runs in float rather than double
+    bool narrow() const {
+        return narrow_;
+    }
 
 private:
+    template<typename T>
     struct FirstOrder {
-        double b0, b1, a1;
-        double z1{0.0};
-        double process(double x);
+        T b0, b1, a1;
+        T z1{0.0};
+        T process(T x);
+        void process(const T *in, T *out, size_t n);
+    };
+
+    // one sample's coefficients of a state-variable section, shared by all
+    // the sections of the cascade
+    struct SvfCoefficients {
+        double a1, a2, a3, k;
     };
 
-    struct Biquad {
-        double b0, b1, b2, a1, a2;
-        double z1{0.0}, z2{0.0};
-        double process(double x);
+    // Topology-preserving state-variable section: the same bilinear
+    // transform as a Biquad, but its coefficients can change between
+    // samples without disturbing the state
+    struct Svf {
+        double ic1{0.0}, ic2{0.0};
+        void process(Type type, const double *in, double *out, size_t n, const SvfCoefficients *coefficients);
     };
 
-    FirstOrder computeFirstOrder(Type type, double fc) const;
+    FirstOrder<double> computeFirstOrder(Type type, double fc) const;
     Biquad computeBiquad(Type type, double fc) const;
+    double warp(double octave) const;
+    void processWide(const double *in, double *out, size_t n);
 
     double fs_;
-    optional<FirstOrder> first_;
+    Type type_;
+    SimdLevel simd_;
+    Precision precision_;
+    optional<FirstOrder<double>> first_;
     vector<Biquad> biquads_;
+
+    // narrow: first_ and biquads_ converted to float, which run instead
+    bool narrow_;
+    optional<FirstOrder<Sample>> narrowFirst_;
+    vector<BasicBiquad<Sample>> narrowBiquads_;
+
+    // modulated version: tan(pi f / fs) every 1/warpSteps of an octave
+    // from warpLowest up to just below Nyquist, and the state of the
+    // first-order section and of the Svf that stand in for biquads_
+    vector<double> warp_;
+    double octave_;             // fc in octaves above warpLowest
+    double onePole_{0.0};
+    vector<Svf> svfs_;
 };
 
+typedef BasicFilter<double> Filter;
+
 Filter::Type parseFilterType(const string &s);
 
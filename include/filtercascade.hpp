@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "biquad.hpp"
+#include "fastmath.hpp"
+#include "filter.hpp"
+
+using namespace std;
+
+// A fixed lowpass or highpass, one sample or one block at a time. Most
+// callers get theirs from makeFilterCascade.
+class Cascade {
+public:
+    virtual ~Cascade()= default;
+    virtual double process(double x)= 0;
+    // block version; in and out may point to the same buffer
+    virtual void process(const double *in, double *out, size_t n)= 0;
+};
+
+// The orders makeFilterCascade builds as FilterCascade: 6 to 96 dB/oct.
+constexpr int maxCascadeOrder= 16;
+
+// Filter's double cascade with its order and type fixed at compile time:
+// the state is an inline array, and each sample runs the stages fully
+// unrolled with no loop or branch between them.
+//
+// Every biquad of a Butterworth cascade at one cutoff has the same
+// coefficients, and b1 and b2 are 2 b0 and b0 (highpass: -2 b0 and b0)
+// exactly, so a stage needs only b0, a1 and a2 and one multiplication of
+// the input. The products come out as in BasicBiquad::process, and the
+// output is bit-identical to Filter.
+//
+// An unrolled sample is a chain of dependent stages. Above unrolledBiquads
+// the SIMD engine, which pipelines the stages across lanes, runs a block
+// faster, and the block version hands the biquads to processCascade; a
+// single sample always takes the unrolled chain.
+template<int Order, FilterTypes::Type Kind>
+class FilterCascade final : public Cascade {
+public:
+    static_assert(Order >= 1, "a cascade needs at least one stage");
+
+    FilterCascade(double fs, double fc, SimdLevel simd= detectSimd(), Precision precision= Precision::FULL)
+        : simd_(simd)
+    {
+        vector<Biquad> sections= Filter(fs, Kind, fc, Order * 6, SimdLevel::SCALAR, precision).sections();
+        size_t next= 0;
+
+        if constexpr (odd) {
+            firstB0_= sections[0].b0;
+            firstA1_= sections[0].a1;
+            next= 1;
+        }
+
+        for (int i= 0; i < biquadCount; ++i)
+            stages_[i]= sections[next + i];
+    }
+
+    double process(double x) override {
+        if constexpr (odd)
+            x= firstOrder(x, firstB0_, firstA1_, firstZ1_);
+
+        if constexpr (biquadCount > 0)
+            x= stageBiquads(x, make_index_sequence<biquadCount>{});
+
+        return x;
+    }
+
+    void process(const double *in, double *out, size_t n) override {
+        if constexpr (biquadCount > unrolledBiquads) {
+            if (simd_ != SimdLevel::SCALAR) {
+                if constexpr (odd) {
+                    const double b0= firstB0_, a1= firstA1_;
+                    double z1= firstZ1_;
+                    for (size_t i= 0; i < n; ++i)
+                        out[i]= firstOrder(in[i], b0, a1, z1);
+                    firstZ1_= z1;
+                    in= out;
+                }
+
+                processCascade(stages_.data(), biquadCount, in, out, n, simd_);
+                return;
+            }
+        }
+
+        // the coefficients and state in locals, so they stay in registers
+        const double firstB0= firstB0_, firstA1= firstA1_;
+        double firstZ1= firstZ1_;
+        const Biquad shared= sharedBiquad();
+        const double b0= shared.b0, a1= shared.a1, a2= shared.a2;
+        array<double, biquadCount> z1, z2;
+        for (int i= 0; i < biquadCount; ++i) {
+            z1[i]= stages_[i].z1;
+            z2[i]= stages_[i].z2;
+        }
+
+        for (size_t i= 0; i < n; ++i) {
+            double x= in[i];
+            if constexpr (odd)
+                x= firstOrder(x, firstB0, firstA1, firstZ1);
+            if constexpr (biquadCount > 0)
+                x= biquads(x, b0, a1, a2, z1, z2, make_index_sequence<biquadCount>{});
+            out[i]= x;
+        }
+
+        firstZ1_= firstZ1;
+        for (int i= 0; i < biquadCount; ++i) {
+            stages_[i].z1= z1[i];
+            stages_[i].z2= z2[i];
+        }
+    }
+
+private:
+    static constexpr bool odd= Order & 1;
+    static constexpr int biquadCount= Order / 2;
+    static constexpr int unrolledBiquads= 3;
+    static constexpr bool lowpass= Kind == FilterTypes::Type::LOWPASS;
+
+    // the coefficients every biquad has; zeros if there are none
+    Biquad sharedBiquad() const {
+        if constexpr (biquadCount > 0)
+            return stages_[0];
+        else
+            return Biquad{};
+    }
+
+    // b1 is b0 (highpass: -b0)
+    [[gnu::always_inline]] static double firstOrder(double x, double b0, double a1, double &z1) {
+        double p= b0 * x;
+        double y= p + z1;
+        z1= (lowpass ? p : -p) - a1 * y;
+        return y;
+    }
+
+    [[gnu::always_inline]] static double biquad(double x, double b0, double a1, double a2, double &z1, double &z2) {
+        double p= b0 * x;
+        double y= p + z1;
+        z1= (lowpass ? p + p : -(p + p)) - a1 * y + z2;
+        z2= p - a2 * y;
+        return y;
+    }
+
+    // one sample through the state in stages_
+    template<size_t... I>
+    [[gnu::always_inline]] double stageBiquads(double x, index_sequence<I...>) {
+        const double b0= stages_[0].b0, a1= stages_[0].a1, a2= stages_[0].a2;
+        ((x= biquad(x, b0, a1, a2, stages_[I].z1, stages_[I].z2)), ...);
+        return x;
+    }
+
+    template<size_t... I>
+    [[gnu::always_inline]] static double biquads(double x, double b0, double a1, double a2,
+        array<double, biquadCount> &z1, array<double, biquadCount> &z2, index_sequence<I...>) {
+        ((x= biquad(x, b0, a1, a2, z1[I], z2[I])), ...);
+        return x;
+    }
+
+    SimdLevel simd_;
+    double firstB0_{0.0}, firstA1_{0.0}, firstZ1_{0.0};
+    array<Biquad, biquadCount> stages_;
+};
+
+// The cascade for rolloff_db: a FilterCascade up to maxCascadeOrder * 6
+// dB/oct, past it a Filter behind the same interface. Throws as Filter
+// does.
+unique_ptr<Cascade> makeFilterCascade(double fs, FilterTypes::Type type, double fc, int rolloff_db,
+    SimdLevel simd= detectSimd(), Precision precision= Precision::FULL);
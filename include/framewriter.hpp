@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Writes rendered frames (0x00RRGGBB pixels, as drawn for SDL's RGB888
+// textures) without any display server.
+//
+// If path contains a printf conversion (e.g. "frame_%05d.png") every frame
+// goes to its own numbered file; otherwise all frames are appended to path,
+// "-" being stdout, which suits `ffmpeg -f image2pipe` (ppm, png) or
+// `-f rawvideo -pix_fmt rgba` (rgba).
+class FrameWriter {
+public:
+    enum class Type { PPM, PNG, RGBA };
+
+    FrameWriter(const string &path, Type type, int width, int height);
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter &)= delete;
+    FrameWriter &operator=(const FrameWriter &)= delete;
+
+    // pitch in pixels
+    void write(const uint32_t *pixels, int pitch);
+
+    size_t frames() const {
+        return frames_;
+    }
+
+private:
+    void encodePpm(const uint32_t *pixels, int pitch);
+    void encodePng(const uint32_t *pixels, int pitch);
+    void encodeRgba(const uint32_t *pixels, int pitch);
+
+    string path_;
+    Type type_;
+    int width_;
+    int height_;
+    bool numbered_;
+    FILE *stream_;
+    vector<uint8_t> bytes_;
+    size_t frames_;
+};
+
+FrameWriter::Type parseFrameType(const string &s);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <ctime>
+
+using namespace std;
+
+// Paces a module's output against the wall clock, one block at a time.
+//   REALTIME   - sleep to absolute deadlines (no drift accumulates)
+//   OFFLINE    - no pacing; render as fast as the CPU allows
+//   DOWNSTREAM - no local clock; flush every block and let a real-time
+//                consumer throttle us through pipe backpressure
+class Pacer {
+public:
+    enum class Mode { REALTIME, OFFLINE, DOWNSTREAM };
+
+    Pacer(Mode mode, double sampleRate);
+
+    // Waits until the next block of `samples` is due. The first call starts
+    // the clock; deadlines are computed from the total sample count, so
+    // rounding never accumulates.
+    void wait(size_t samples);
+
+    Mode mode() const {
+        return mode_;
+    }
+
+    // whether writers should flush after every block
+    bool flushEachBlock() const {
+        return mode_ != Mode::OFFLINE;
+    }
+
+    // largest lateness seen at a deadline, in seconds
+    double maxDrift() const {
+        return maxDrift_;
+    }
+
+    // prints a one-line drift summary to stderr (realtime mode only)
+    void report(const string &name) const;
+
+private:
+    Mode mode_;
+    double nsPerSample_;
+    timespec start_;
+    bool started_;
+    uint64_t samples_;
+    uint64_t blocks_;
+    uint64_t lateBlocks_;
+    double maxDrift_;
+    double lastBlockSeconds_;
+};
+
+// Resolves the --realtime / --offline / --clock-from-downstream flags;
+// throws if more than one is set.
+Pacer::Mode parsePacing(bool realtime, bool offline, bool downstream, Pacer::Mode fallback);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "scheduler.hpp"
+
+using namespace std;
+
+// One module instance inside an in-process patch.
+class Node {
+public:
+    virtual ~Node()= default;
+
+    // Processes one block in place. Sources overwrite the block and return
+    // fewer than n samples once they run out; 0 means the source is done.
+    virtual size_t process(double *block, size_t n)= 0;
+
+    virtual bool isSource() const {
+        return false;
+    }
+
+    virtual double sampleRate() const= 0;
+};
+
+// A chain of modules run block-by-block in a single process. Every node
+// works in place on the caller's block, so nothing is copied between stages.
+//
+// The chain uses the same syntax as the shell pipeline it replaces, minus
+// the I/O options:
+//   cv --duration 3 | vco --wave_type square --sensitivity 100 | filter --cutoff 3000
+class Patch {
+public:
+    explicit Patch(const string &chain);
+
+    // one stage per line (or '|' separated), '#' starts a comment
+    static Patch load(const string &path);
+
+    bool hasSource() const {
+        return !nodes_.empty() && nodes_.front()->isSource();
+    }
+
+    double sampleRate() const {
+        return nodes_.back()->sampleRate();
+    }
+
+    // Runs one block through every stage; returns the samples produced,
+    // 0 once a source has finished.
+    size_t process(double *block, size_t n);
+
+private:
+    vector<unique_ptr<Node>> nodes_;
+};
+
+// Independent patches (branches) summed at a mix point, optionally followed
+// by a mix chain that runs on the sum:
+//
+//   branch 1: cv | vco --sensitivity 100 | filter --cutoff 3000 ─┐
+//   branch 2: cv | vco --sensitivity 150 | filter --cutoff 800  ─┴─ + ── mix
+//
+// Each branch renders into its own buffer, so branches run on the scheduler
+// in parallel. The sum is taken in branch order once all of them finish,
+// which keeps the output bit-identical for any thread count.
+class Graph {
+public:
+    Graph(vector<Patch> branches, optional<Patch> mix, size_t threads);
+
+    bool hasSource() const {
+        return branches_.front().hasSource();
+    }
+
+    double sampleRate() const {
+        return branches_.front().sampleRate();
+    }
+
+    // Same contract as Patch::process. Without sources, every branch gets
+    // a copy of the input block. A source branch that ends early adds
+    // silence; the graph ends when every source is done.
+    size_t process(double *block, size_t n);
+
+private:
+    vector<Patch> branches_;
+    optional<Patch> mix_;
+    Scheduler scheduler_;
+    vector<vector<double>> buffers_;
+    vector<size_t> produced_;
+};
+
+unique_ptr<Node> makeNode(const vector<string> &args);
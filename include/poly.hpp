@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "biquad.hpp"
+#include "vco.hpp"
+
+using namespace std;
+
+// Many Vco -> Filter -> ADSR voices run side by side. The per-voice state
+// (oscillator phase, envelope stage/counter/level, filter z1/z2) is kept as
+// struct-of-arrays so each per-sample update runs across all voices at once.
+//
+// Notes arrive on lanes, each one a (cv, gate) pair. A rising gate claims a
+// voice for its lane and a falling gate releases it. When no voice is free,
+// the quietest releasing voice is stolen, or else the oldest one.
+//
+// A voice's oscillator advances like Vco's naive engine, including the
+// triangle's 2 f / fs per sample, so one voice plays the pitch vco would.
+// A claimed or stolen voice starts from a zero phase and a cleared filter.
+class Poly {
+public:
+    Poly(double sampleRate, size_t voices, double sensitivity, double amplitude, Vco::WaveType waveType,
+        float attack, float decay, float sustain, float release, SimdLevel simd= detectSimd());
+
+    // per-voice copy of a filter cascade (see Filter::sections())
+    void setFilter(const vector<Biquad> &sections);
+
+    void noteOn(size_t lane, double controlVoltage);
+    void noteOff(size_t lane);
+
+    // lanes holds frames * laneCount interleaved (cv, gate) pairs; out gets
+    // the mono mix of all voices
+    void process(const double *lanes, size_t laneCount, double *out, size_t frames);
+
+    size_t voices() const {
+        return voices_;
+    }
+
+    // voices not idle
+    size_t active() const;
+
+private:
+    size_t allocate();
+    // phase increment per sample for controlVoltage
+    double increment(double controlVoltage) const;
+
+    double sampleRate_;
+    size_t voices_;
+    size_t padded_;             // voices_ rounded up to the vector width
+    double sensitivity_;
+    double amplitude_;
+    Vco::WaveType waveType_;
+    float attack_, decay_, sustain_, release_;
+    SimdLevel simd_;
+    uint64_t clock_;
+
+    // struct-of-arrays voice state, padded_ entries each
+    vector<double> phase_;      // normalized [0, 1)
+    vector<double> increment_;  // phase increment per sample
+    vector<int32_t> stage_;     // Stage as int
+    vector<int32_t> counter_;
+    vector<float> level_;
+
+    // allocator bookkeeping, voices_ entries each
+    vector<long> owner_;        // lane, or -1
+    vector<uint64_t> started_;
+
+    // per lane
+    vector<bool> gates_;
+    vector<double> cv_;
+    vector<long> voice_;        // voice playing the lane, or -1
+
+    unique_ptr<BiquadBank> filter_;
+    vector<double> wave_;       // frames x padded_, oscillator then filter output
+    vector<float> envelope_;    // frames x padded_
+};
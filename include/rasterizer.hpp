@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "biquad.hpp"
+#include "envelope.hpp"
+
+using namespace std;
+
+// Composes the envelopes of any number of traces into a 0x00RRGGBB
+// framebuffer one row at a time, so each row is written once and stays in
+// cache while every trace is laid over it.
+//
+// A trace is a layer holding, per column, the first and last row it
+// covers. Drawing a row over a layer is a compare-and-select across all
+// columns, done 4 (SSE2) or 8 (AVX2) columns at a time; layers whose
+// rows lie wholly above or below the row are skipped.
+//
+// The previous frame's layers are kept as well. When the traces cover
+// little of the framebuffer, updateColumns() brings one that still holds
+// the previous frame up to date by rewriting only the pixels under the
+// old and the new traces, rather than every row they cross.
+class Rasterizer {
+public:
+    typedef void (*BlendFunction)(const int32_t *top, const int32_t *bottom, uint32_t color, int y, uint32_t *row, size_t width);
+
+    Rasterizer(int width, int height, SimdLevel simd= detectSimd());
+
+    // starts the next frame; the current traces become the previous ones
+    void clear();
+
+    // Adds the trace of one envelope column per pixel column; +halfScale is
+    // the top row and -halfScale the bottom one. With rms, a second layer
+    // shows the RMS band in a lighter shade of color.
+    void addTrace(const Envelope::Column *columns, float halfScale, uint32_t color, bool rms);
+
+    // draws row y of every layer over row, in the order they were added
+    void drawRow(int y, uint32_t *row) const;
+
+    // Updates a framebuffer holding the previous frame's traces over
+    // background, where background[y] is row y without any: the previous
+    // spans are restored from it and the current ones drawn, a column at a
+    // time.
+    void updateColumns(uint32_t *pixels, const uint32_t *const *background) const;
+
+    // rows touched by the current or previous layers; firstRow() >
+    // lastRow() when there are none
+    int firstRow() const;
+    int lastRow() const;
+
+    // pixels covered by the current and previous layers, overlaps counted
+    // every time: what updateColumns() writes
+    size_t coverage() const;
+
+private:
+    struct Layer {
+        vector<int32_t> top;
+        vector<int32_t> bottom;
+        int32_t first;      // rows the layer touches at all
+        int32_t last;
+        size_t area;        // pixels covered
+        uint32_t color;
+    };
+
+    Layer &nextLayer(uint32_t color);
+
+    int width_;
+    int height_;
+    BlendFunction blend_;
+    vector<Layer> layers_;  // kept across frames to reuse the storage
+    size_t used_;
+    vector<Layer> previous_;
+    size_t previousUsed_;
+};
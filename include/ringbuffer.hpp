@@ -1,43 +1,60 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
-#include <vector>
+#include <bit>
 #include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
+// Single-producer/single-consumer ring.
+//
+// The capacity is rounded up to a power of two so positions wrap with a
+// mask. head_ and tail_ count items ever written/read and are never wrapped
+// themselves, so every slot is usable and head_ - tail_ is the fill level.
+// Each index lives on its own cache line together with the owning side's
+// cached copy of the other index; the remote atomic is only reloaded when
+// the cached value says the ring is full (producer) or empty (consumer),
+// or, for the spans and blocks, holds less room or data than asked for.
 template<typename T>
 class RingBuffer {
 public:
     explicit RingBuffer(size_t capacity)
-        : capacity_(capacity + 1), buffer_(capacity_), head_(0), tail_(0) {}
+        : capacity_(bit_ceil(max<size_t>(capacity, 1))), mask_(capacity_ - 1), buffer_(capacity_),
+        head_(0), cachedTail_(0), tail_(0), cachedHead_(0) {}
 
     const std::vector<T>& data() const {
-         return buffer_; 
+         return buffer_;
     }
 
-    size_t head() const { 
-        return head_; 
+    // position of the next write within data()
+    size_t head() const {
+        return head_.load(memory_order_acquire) & mask_;
     }
 
+    // position of the next read within data()
     size_t tail() const {
-        return tail_; 
+        return tail_.load(memory_order_acquire) & mask_;
     }
 
-    size_t capacity() const { 
-        return capacity_; 
+    size_t capacity() const {
+        return capacity_;
     }
 
     bool push(const T &item) {
         size_t head = head_.load(memory_order_relaxed);
-        size_t nextHead = increment(head);
 
-        if (nextHead == tail_.load(memory_order_acquire)) {
-            return false; // full
+        if (head - cachedTail_ == capacity_) {
+            cachedTail_ = tail_.load(memory_order_acquire);
+            if (head - cachedTail_ == capacity_)
+                return false; // full
         }
 
-        buffer_[head] = item;
-        head_.store(nextHead, memory_order_release);
+        buffer_[head & mask_] = item;
+        head_.store(head + 1, memory_order_release);
         return true;
     }
 
@@ -45,64 +62,130 @@ public:
 
         size_t tail = tail_.load(memory_order_relaxed);
 
-        if (tail == head_.load(memory_order_acquire)) {
-            return false;
+        if (tail == cachedHead_) {
+            cachedHead_ = head_.load(memory_order_acquire);
+            if (tail == cachedHead_)
+                return false;
         }
 
-        item = buffer_[tail];
-        tail_.store(increment(tail), memory_order_release);
+        item = buffer_[tail & mask_];
+        tail_.store(tail + 1, memory_order_release);
 
         return true;
     }
 
+    // Producer side: the free space as up to two contiguous spans (the
+    // second is non-empty when the free region wraps). Fill them in order,
+    // then publish with commitWrite(). The space is as of the cached tail
+    // when that leaves at least wanted items free, so it may be less than
+    // the consumer has since released.
+    pair<span<T>, span<T>> writeSpans(size_t wanted = 1) {
+        size_t head = head_.load(memory_order_relaxed);
+
+        if (capacity_ - (head - cachedTail_) < wanted)
+            cachedTail_ = tail_.load(memory_order_acquire);
+
+        return spans<T>(head, capacity_ - (head - cachedTail_));
+    }
+
+    void commitWrite(size_t count) {
+        head_.store(head_.load(memory_order_relaxed) + count, memory_order_release);
+    }
+
+    // Consumer side: the readable items as up to two contiguous spans,
+    // oldest first. Release them with commitRead(). Like writeSpans(), the
+    // head is reloaded only when the cached one shows fewer than wanted.
+    pair<span<const T>, span<const T>> readSpans(size_t wanted = 1) {
+        size_t tail = tail_.load(memory_order_relaxed);
+
+        if (cachedHead_ - tail < wanted)
+            cachedHead_ = head_.load(memory_order_acquire);
+
+        return spans<const T>(tail, cachedHead_ - tail);
+    }
+
+    void commitRead(size_t count) {
+        tail_.store(tail_.load(memory_order_relaxed) + count, memory_order_release);
+    }
+
+    // Copies as many of count items as fit; returns the number written.
+    size_t pushBlock(const T *src, size_t count) {
+        auto [first, second] = writeSpans(count);
+        size_t n = min(count, first.size() + second.size());
+        size_t split = min(n, first.size());
+
+        copy(src, src + split, first.begin());
+        copy(src + split, src + n, second.begin());
+        commitWrite(n);
+
+        return n;
+    }
+
+    // Moves up to count items into dest; returns the number read.
+    size_t popBlock(T *dest, size_t count) {
+        auto [first, second] = readSpans(count);
+        size_t n = min(count, first.size() + second.size());
+        size_t split = min(n, first.size());
+
+        copy(first.begin(), first.begin() + split, dest);
+        copy(second.begin(), second.begin() + (n - split), dest + split);
+        commitRead(n);
+
+        return n;
+    }
+
     bool isEmpty() const {
-        return head_.load(memory_order_acquire) == tail_.load(memory_order_acquire);
+        return size() == 0;
     }
 
     bool isFull() const {
-        return increment(head_.load(memory_order_acquire)) == tail_.load(memory_order_acquire);
+        return size() == capacity_;
     }
 
     size_t size() const {
-        size_t head = head_.load(memory_order_acquire);
         size_t tail = tail_.load(memory_order_acquire);
-        return (head + capacity_ - tail) % capacity_;
+        size_t head = head_.load(memory_order_acquire);
+        return head - tail;
     }
 
-    void copyFromTail(size_t offsetFromHead, T* dest, size_t count) {
+    // Copies the `count` items that end `offsetFromHead` items before the
+    // newest one; zero-fills dest if the ring does not hold that many.
+    void copyFromTail(size_t offsetFromHead, T* dest, size_t count) const {
 
-        size_t safeHead = head_;
-        size_t safeTail = tail_;
-    
-        size_t size;
-        if (safeHead >= safeTail) {
-            size = safeHead - safeTail;
-        } else {
-            size = capacity_ - (safeTail - safeHead);
-        }
-    
-        // Check: do we have enough data to satisfy the request?
-        if (offsetFromHead + count > size) {
-            std::fill(dest, dest + count, 0);
+        size_t tail = tail_.load(memory_order_acquire);
+        size_t head = head_.load(memory_order_acquire);
+
+        if (offsetFromHead + count > head - tail) {
+            std::fill(dest, dest + count, T{});
             return;
         }
-    
-        // We want to copy `count` samples ending `offsetFromHead` samples before head
-        size_t startIndex = (safeHead + capacity_ - offsetFromHead - count) % capacity_;
-    
-        for (size_t i = 0; i < count; ++i) {
-            dest[i] = buffer_[(startIndex + i) % capacity_];
-        }
+
+        size_t start = (head - offsetFromHead - count) & mask_;
+        size_t split = min(count, capacity_ - start);
+
+        std::copy(buffer_.begin() + start, buffer_.begin() + start + split, dest);
+        std::copy(buffer_.begin(), buffer_.begin() + (count - split), dest + split);
     }
 
 private:
-    size_t increment(size_t index) const {
-        return (index + 1) % capacity_;
+    template<typename U>
+    pair<span<U>, span<U>> spans(size_t position, size_t count) const {
+        U *base = const_cast<U *>(buffer_.data());
+        size_t start = position & mask_;
+        size_t split = min(count, capacity_ - start);
+
+        return { span<U>(base + start, split), span<U>(base, count - split) };
     }
 
     const size_t capacity_;
+    const size_t mask_;
     vector<T> buffer_;
-    atomic<size_t> head_;
-    atomic<size_t> tail_;
-};
 
+    // producer's cache line
+    alignas(64) atomic<size_t> head_;
+    size_t cachedTail_;
+
+    // consumer's cache line
+    alignas(64) atomic<size_t> tail_;
+    size_t cachedHead_;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fork/join thread pool with work stealing, used to run independent patch
+// branches in parallel once per block.
+//
+// run() deals the tasks round-robin onto per-thread deques. Every thread
+// (the caller included) pops from the front of its own deque and, once it
+// is empty, steals from the back of the others. Idle workers spin briefly
+// before sleeping, since a new block usually follows within microseconds.
+class Scheduler {
+public:
+    // threads counts the calling thread; 0 uses every hardware thread
+    explicit Scheduler(size_t threads);
+    ~Scheduler();
+
+    Scheduler(const Scheduler &)= delete;
+    Scheduler &operator=(const Scheduler &)= delete;
+
+    size_t threads() const {
+        return queues_.size();
+    }
+
+    // Calls task(i) for every i < count and returns once all calls are done.
+    // The first exception thrown by a task is rethrown here.
+    void run(size_t count, const function<void(size_t)> &task);
+
+private:
+    struct Queue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+
+    void work(size_t self);
+    bool runOne(size_t self);
+
+    vector<unique_ptr<Queue>> queues_;
+    vector<thread> threads_;
+
+    const function<void(size_t)> *task_;
+    atomic<size_t> pending_;
+    atomic<uint64_t> generation_;
+    bool stop_;
+    mutex lock_;
+    condition_variable wake_;
+
+    mutex errorLock_;
+    exception_ptr error_;
+};
+
+// validates --threads; 0 means every hardware thread
+size_t parseThreads(int threads);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// Single-producer/single-consumer ring of float64 samples in a POSIX shared
+// memory object, connecting two module processes without a pipe.
+//
+// Both ends open /dev/shm/clmodular-NAME; whichever comes first creates and
+// initialises it. Blocks are copied straight into and out of the shared
+// mapping (or produced in place through the span API), and a side only
+// enters the kernel to sleep on a futex when the ring is empty (consumer)
+// or full (producer). The consumer unlinks the object when it closes.
+class ShmRing {
+public:
+    enum class Role { PRODUCER, CONSUMER };
+
+    static constexpr size_t defaultCapacity= 1 << 16;   // samples
+
+    // Throws runtime_error if shared memory or futexes are unavailable.
+    // sampleRate and channels are published by the producer; the consumer
+    // reads them back with sampleRate()/channels().
+    ShmRing(const string &name, Role role, double sampleRate= 0.0, uint32_t channels= 1);
+    ~ShmRing();
+
+    ShmRing(const ShmRing &)= delete;
+    ShmRing &operator=(const ShmRing &)= delete;
+
+    // producer: blocks until every sample is in the ring
+    void write(const double *src, size_t count);
+    // producer: marks the end of the stream
+    void close();
+
+    // consumer: blocks until at least one whole frame is available (or
+    // returns 0 straight away if wait is false); returns 0 once the
+    // producer has closed and the ring is drained, see finished()
+    size_t read(double *dest, size_t count, bool wait= true);
+
+    // consumer: the producer has closed and every sample has been read
+    bool finished() const;
+
+    // consumer: wait for the producer to publish its stream parameters
+    uint32_t channels();
+    double sampleRate();
+
+    // Zero-copy access, as in RingBuffer: up to two contiguous spans of
+    // free space (producer) or of readable samples (consumer). The
+    // producer's spans may be empty if the ring is full.
+    pair<span<double>, span<double>> writeSpans();
+    void commitWrite(size_t count);
+    pair<span<const double>, span<const double>> readSpans();
+    void commitRead(size_t count);
+
+private:
+    struct Shared;
+
+    static size_t headerBytes();
+    void waitForProducer();
+
+    Shared *shared_;
+    double *data_;
+    size_t capacity_;
+    size_t bytes_;
+    int fd_;
+    Role role_;
+    string path_;
+    bool closed_;
+};
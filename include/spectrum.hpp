@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "envelope.hpp"
+#include "fft.hpp"
+
+using namespace std;
+
+// Averaged magnitude spectrum of successive frames, in dB.
+//
+// Each frame is windowed and transformed by Fft. Levels are scaled by the
+// window's coherent gain, so a sine of amplitude 1 reads 0 dB whichever
+// window is used. Averaging works on power: exponential averaging weighs
+// the previous spectrum by smoothing, and peak hold keeps the highest
+// power seen in each bin until reset().
+class Spectrum {
+public:
+    enum class Window { RECTANGULAR, HANN, HAMMING, BLACKMAN_HARRIS, FLAT_TOP };
+    enum class Averaging { NONE, EXPONENTIAL, PEAK };
+
+    Spectrum(size_t size, Window window, Averaging averaging, float smoothing);
+
+    size_t size() const {
+        return fft_.size();
+    }
+
+    size_t bins() const {
+        return fft_.bins();
+    }
+
+    // analyses size() samples, oldest first
+    void process(const float *frame);
+    void reset();
+
+    // per bin, bins() of them
+    const vector<float> &decibels() const {
+        return decibels_;
+    }
+
+private:
+    Fft fft_;
+    Averaging averaging_;
+    float smoothing_;
+    vector<float> window_;
+    float scale_;               // power of a bin, relative to a unit sine
+    vector<float> windowed_;
+    vector<float> re_;
+    vector<float> im_;
+    vector<float> power_;
+    vector<float> decibels_;
+    bool empty_;
+};
+
+Spectrum::Window parseWindow(const string &s);
+Spectrum::Averaging parseAveraging(const string &s);
+
+// Splits [low, high) Hz into width columns on a log axis. Each column
+// spans the levels between its edges, interpolated between bins where a
+// column is narrower than a bin, so neighbouring columns join up.
+void spectrumColumns(const float *decibels, size_t bins, double binWidth, double low, double high,
+    Envelope::Column *out, size_t width);
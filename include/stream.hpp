@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "control.hpp"
+#include "shmring.hpp"
+
+using namespace std;
+
+// Wire formats shared by every module's stdin/stdout.
+//   TEXT - one sample per line, or one frame of blank- or comma-separated
+//          columns per line (default, human readable)
+//   RAW  - headerless interleaved float32, native byte order
+//   F32  - StreamHeader followed by interleaved float32
+//   F64  - StreamHeader followed by interleaved float64
+//   CTL  - StreamHeader followed by control runs: a uint32 frame count and
+//          one float32 per channel, the frame held for that many frames.
+//          Values are taken once per controlPeriod frames.
+enum class Format { TEXT, RAW, F32, F64, CTL };
+
+enum class SampleType : uint16_t { FLOAT32= 1, FLOAT64= 2, CONTROL= 3 };
+
+struct StreamHeader {
+    char magic[4];          // "CLMS"
+    uint16_t version;
+    uint16_t sampleType;    // SampleType
+    uint32_t channels;
+    uint32_t sampleRate;
+};
+
+static_assert(sizeof(StreamHeader) == 16, "stream header must stay 16 bytes");
+
+Format parseFormat(const string &s);
+// The same for a module writing audio: ctl holds one value per control
+// period, which would turn a signal into steps, so it throws for ctl too.
+// Readers still take ctl input whatever the format.
+Format parseAudioFormat(const string &s);
+
+// The type a module processes its blocks in, whatever the wire format:
+// float halves the memory traffic and doubles the SIMD lanes.
+enum class ProcessingType { DOUBLE, FLOAT };
+
+ProcessingType parseProcessingType(const string &s);
+
+// Page-aligned storage for the stream buffers: reads and writes move whole
+// pages.
+template<typename T>
+struct PageAllocator {
+    typedef T value_type;
+
+    static constexpr size_t alignment= 4096;
+
+    PageAllocator()= default;
+
+    template<typename U>
+    PageAllocator(const PageAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(alignment)));
+    }
+
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, align_val_t(alignment));
+    }
+
+    template<typename U>
+    bool operator==(const PageAllocator<U> &) const {
+        return true;
+    }
+};
+
+typedef vector<char, PageAllocator<char>> StreamBuffer;
+
+// Both ends take an optional shared-memory ring name. When it is set the
+// samples go through a ShmRing instead of fd (the format is then ignored,
+// and a reader only polls the ring if fd is non-blocking); if the ring
+// cannot be set up they fall back to fd with a warning.
+class SampleReader {
+public:
+    // channels sets the frame size of text and raw streams, which carry no
+    // header; binary streams take theirs from the header
+    SampleReader(int fd, Format format, const string &shm= "", uint32_t channels= 1);
+
+    // Reads up to count samples; blocks until at least one is available
+    // unless the fd is non-blocking. Returns 0 at end of stream (see eof()).
+    // Sample is double or float; a float32 stream read into floats is
+    // copied as it is.
+    template<typename Sample>
+    size_t read(Sample *dest, size_t count);
+
+    bool eof() const {
+        return eof_;
+    }
+
+    const StreamHeader &header() const {
+        return header_;
+    }
+
+    // Channel count from the stream header, or the constructor's for text
+    // and raw streams. Waits for the header if it has not been read yet.
+    // Reads of more than one channel always return whole frames.
+    uint32_t channels();
+
+    // Whether this is a control (CTL) stream, which can be read as runs;
+    // waits for the header like channels(). read() expands any stream.
+    bool control();
+
+    // Reads up to count runs of a single-channel control stream, like
+    // read(). A run split by a block boundary upstream may come back as
+    // two runs of the same value.
+    size_t readRuns(ControlRun *dest, size_t count);
+
+private:
+    bool fill();
+    bool readHeader();
+    void waitReadable();
+    template<typename Sample>
+    size_t decodeText(Sample *dest, size_t count);
+    template<typename Sample>
+    size_t decodeBinary(Sample *dest, size_t count);
+    template<typename Sample>
+    size_t decodeControl(Sample *dest, size_t count);
+    bool nextRun();
+
+    int fd_;
+    Format format_;
+    unique_ptr<ShmRing> shm_;
+    bool blocking_;
+    SampleType sampleType_;
+    uint32_t textChannels_;
+    StreamHeader header_;
+    bool headerRead_;
+    bool eof_;
+    StreamBuffer buffer_;
+    size_t begin_;
+    size_t end_;
+    size_t runLeft_;            // control: frames left of the current run
+    vector<double> runFrame_;
+    vector<double> widened_;    // float reads from shm: the ring's doubles
+};
+
+// When fd is a pipe the writer enlarges it, so a slow reader stalls the
+// writer less often. Each flush copies the buffer into fd with write():
+// pages handed over with vmsplice stay referenced by the pipe, and a
+// consumer that splice()s them onward would see the buffer rewritten.
+class SampleWriter {
+public:
+    SampleWriter(int fd, Format format, double sampleRate, uint32_t channels= 1, const string &shm= "");
+    ~SampleWriter();
+
+    // Sample is double or float, like SampleReader::read()
+    template<typename Sample>
+    void write(const Sample *src, size_t count);
+    // frames frames all holding frame (one value per channel); a CTL
+    // stream writes it as a single run
+    void writeRun(const double *frame, size_t frames);
+    void flush();
+
+private:
+    void reserve(size_t bytes);
+    void writeControl(const double *src, size_t frames);
+    void holdFrame(const double *frame);
+    void emitRun();
+
+    int fd_;
+    Format format_;
+    unique_ptr<ShmRing> shm_;
+    StreamBuffer buffer_;
+    size_t flushed_;    // start of the bytes not yet handed to fd
+    size_t used_;
+    uint32_t channels_;
+    uint32_t column_;   // text: position within the current frame
+    size_t position_;   // control: frames written
+    size_t runFrames_;  // control: frames of the held frame not yet emitted
+    vector<double> runFrame_;
+    vector<double> expanded_;   // writeRun() to other formats: the frame repeated
+    vector<double> widened_;    // float writes to shm or ctl, as doubles
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Streaming edge detector for the scope.
+//
+// Samples are fed once, as they arrive, through a small state machine:
+// O(1) per sample, nothing is ever rescanned. A crossing only counts once
+// the signal has been on the far side of the hysteresis band (level -
+// hysteresis for rising edges, level + hysteresis for falling ones), and
+// crossings within holdoff samples of the last trigger are ignored. Trigger
+// positions are stream positions (samples fed before the crossing sample)
+// kept in a small ring, the newest history of them.
+class Trigger {
+public:
+    enum class Edge { RISING, FALLING, BOTH };
+    enum class Mode { AUTO, NORMAL, SINGLE };
+
+    Trigger(float level, float hysteresis, Edge edge, uint64_t holdoff, size_t history);
+
+    void process(const float *samples, size_t count);
+
+    // samples fed so far
+    uint64_t position() const {
+        return position_;
+    }
+
+    // the newest recorded trigger at or before position limit
+    optional<uint64_t> latest(uint64_t limit) const;
+
+private:
+    void record();
+
+    float level_;
+    float hysteresis_;
+    Edge edge_;
+    uint64_t holdoff_;
+    bool armedRising_;
+    bool armedFalling_;
+    uint64_t position_;
+    uint64_t nextAllowed_;
+    vector<uint64_t> index_;
+    uint64_t recorded_;
+};
+
+Trigger::Edge parseTriggerEdge(const string &s);
+Trigger::Mode parseTriggerMode(const string &s);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+using namespace std;
+
+// Lock-free single-producer/single-consumer handoff of whole frames.
+//
+// The producer fills back() and publish()es it; the consumer picks up the
+// newest published frame with update() and reads it through front(). The
+// third slot sits between them, so neither side ever waits for the other:
+// a frame published while the consumer is still reading simply replaces
+// any frame it has not picked up yet.
+template<typename T>
+class TripleBuffer {
+public:
+    explicit TripleBuffer(const T &initial)
+        : slots_{ initial, initial, initial }, middle_(1), back_(0), front_(2) {}
+
+    T &back() {
+        return slots_[back_];
+    }
+
+    void publish() {
+        back_= middle_.exchange(back_ | fresh, memory_order_acq_rel) & indexMask;
+    }
+
+    // true if a new frame was picked up since the last call
+    bool update() {
+        if (!(middle_.load(memory_order_relaxed) & fresh))
+            return false;
+
+        front_= middle_.exchange(front_, memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T &front() const {
+        return slots_[front_];
+    }
+
+private:
+    static constexpr unsigned fresh= 4;
+    static constexpr unsigned indexMask= 3;
+
+    T slots_[3];
+    alignas(64) atomic<unsigned> middle_;   // slot index, plus fresh once published
+    alignas(64) unsigned back_;             // producer only
+    alignas(64) unsigned front_;            // consumer only
+};
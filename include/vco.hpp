@@ -1,16 +1,60 @@
 #pragma once
 
-class Vco {
-public:
+#include <cstddef>
+#include <string>
+
+#include "control.hpp"
+#include "fastmath.hpp"
+
+class WavetableSet;
+
+// The parts of a Vco shared by every sample type.
+struct VcoTypes {
     enum WaveType { SINE, TRIANGLE, SQUARE };
-    Vco(double sampleRate, double sensitivity, double amplitude);
+    // NAIVE evaluates the ideal waveform (aliases at high frequencies),
+    // WAVETABLE reads mip-mapped band-limited tables, POLYBLEP corrects the
+    // naive square/triangle discontinuities with polynomial residuals
+    enum class Engine { NAIVE, WAVETABLE, POLYBLEP };
+};
+
+// Sample is the type of the blocks, double or float. The phase always
+// accumulates in double, as float would drift audibly within seconds; a
+// float block of naive sines wraps each phase to one turn in double and
+// evaluates the sine in float lanes, twice as many per vector. The single
+// sample generators work in double for either.
+template<typename Sample>
+class BasicVco : public VcoTypes {
+public:
+    // precision: how closely the sine follows libm (fastmath.hpp)
+    BasicVco(double sampleRate, double sensitivity, double amplitude, Engine engine= Engine::NAIVE,
+        Precision precision= Precision::FULL);
     double generateSineWave(double controlVoltage);
     double generateTriangleWave(double controlVoltage);
     double generateSquareWave(double controlVoltage);
+    double generateBandLimited(double frequency, WaveType waveType);
     double generateWaveForm(double controlVoltage, WaveType waveType);
+    // block version; controlVoltage and out may point to the same buffer
+    void generateWaveForm(const Sample *controlVoltage, Sample *out, size_t n, WaveType waveType);
+    // control-rate version: controlVoltage is held for the n samples, ramping
+    // from the previous held value over the first control period
+    void generateWaveForm(double controlVoltage, Sample *out, size_t n, WaveType waveType);
 private:
+    void advanceSine(double frequency);
+    double sine(double x) const;
+
     double sampleRate_;
     double sensitivity_;
     double amplitude_;
     double phase_;
+    Engine engine_;
+    const WavetableSet *tables_;
+    Precision precision_;
+    // amplitude * sin(phase) over a block at precision_, in vector lanes
+    void (*sineBlock_)(const double *phase, Sample *out, size_t n, double amplitude);
+    ControlRamp controlVoltage_;
 };
+
+typedef BasicVco<double> Vco;
+
+Vco::WaveType parseWaveType(const std::string &value);
+Vco::Engine parseEngine(const std::string &value);
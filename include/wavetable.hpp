@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "vco.hpp"
+
+using namespace std;
+
+// Mip-mapped, band-limited single-cycle tables for one wave type. Level k
+// holds the first (maxHarmonics >> k) harmonics, so every octave of
+// fundamental frequency gets the richest table that stays below Nyquist.
+class Wavetable {
+public:
+    static constexpr size_t tableSize= 2048;
+    static constexpr size_t maxHarmonics= tableSize / 2;
+    static constexpr size_t levels= 11;     // 1024 harmonics down to 1
+
+    explicit Wavetable(Vco::WaveType waveType);
+    Wavetable(Vco::WaveType waveType, vector<double> data);
+
+    // Linearly interpolated lookup at phase in [0, 1) from the table that
+    // is band-limited for `frequency` at `sampleRate`.
+    double lookup(double phase, double frequency, double sampleRate) const {
+        const double *table= level(frequency, sampleRate);
+        double position= phase * tableSize;
+        size_t index= static_cast<size_t>(position);
+        double fraction= position - index;
+
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+    const double *level(double frequency, double sampleRate) const;
+
+    const vector<double> &data() const {
+        return data_;
+    }
+
+private:
+    // each level stores tableSize + 1 samples; the last repeats the first
+    // so interpolation never wraps
+    vector<double> data_;
+};
+
+// The sine, triangle and square tables, built once per process and shared
+// by every Vco. With a cache path the tables are loaded from that file when
+// it is valid and written to it otherwise.
+class WavetableSet {
+public:
+    static const WavetableSet &shared(const string &cachePath= "");
+
+    const Wavetable &operator[](Vco::WaveType waveType) const {
+        return tables_[waveType];
+    }
+
+private:
+    WavetableSet();
+    explicit WavetableSet(vector<Wavetable> tables);
+
+    static WavetableSet load(const string &path);
+    void save(const string &path) const;
+
+    vector<Wavetable> tables_;
+};
@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "biquad.hpp"
+
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BIQUAD_X86 1
+#endif
+
+SimdLevel detectSimd()
+{
+#ifdef BIQUAD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+
+    return SimdLevel::SCALAR;
+}
+
+bool simdSupported(SimdLevel level)
+{
+    return level <= detectSimd();
+}
+
+SimdLevel parseSimdLevel(const string &s)
+{
+    SimdLevel level;
+
+    if (s == "auto")
+        return detectSimd();
+    else if (s == "scalar")
+        level= SimdLevel::SCALAR;
+    else if (s == "sse2")
+        level= SimdLevel::SSE2;
+    else if (s == "avx2")
+        level= SimdLevel::AVX2;
+    else if (s == "avx512")
+        level= SimdLevel::AVX512;
+    else
+        throw runtime_error("simd must be 'auto', 'scalar', 'sse2', 'avx2' or 'avx512'");
+
+    if (!simdSupported(level))
+        throw runtime_error(s + " is not supported on this CPU");
+
+    return level;
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level) {
+        case SimdLevel::SSE2:
+            return "sse2";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+template<typename T>
+T BasicBiquad<T>::process(T x)
+{
+    T y= b0 * x + z1;
+    z1= b1 * x - a1 * y + z2;
+    z2= b2 * x - a2 * y;
+
+    return y;
+}
+
+template<typename T>
+void BasicBiquad<T>::process(const T *in, T *out, size_t n)
+{
+    T s1= z1;
+    T s2= z2;
+
+    for (size_t i= 0; i < n; ++i) {
+        T x= in[i];
+        T y= b0 * x + s1;
+        s1= b1 * x - a1 * y + s2;
+        s2= b2 * x - a2 * y;
+        out[i]= y;
+    }
+
+    z1= s1;
+    z2= s2;
+}
+
+namespace {
+
+// GCC vector extensions; the kernels are instantiated inside functions
+// carrying the matching target attribute. W lanes of T, and the integer
+// lanes of the same width for masks.
+template<int W, typename T> struct Lanes {
+    typedef conditional_t<is_same_v<T, float>, int, long long> lane;
+    typedef T vec __attribute__((vector_size(W * sizeof(T))));
+    typedef lane mask __attribute__((vector_size(W * sizeof(T))));
+};
+
+// lanes of T in a register of the given bytes
+template<typename T, size_t bytes>
+constexpr int lanes= bytes / sizeof(T);
+
+// Pipelines up to W stages across the lanes of one vector.
+template<int W, typename T>
+[[gnu::always_inline]] inline void cascadeGroup(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n)
+{
+    using vec= typename Lanes<W, T>::vec;
+    using mask= typename Lanes<W, T>::mask;
+    using lane= typename Lanes<W, T>::lane;
+
+    vec b0{}, b1{}, b2{}, a1{}, a2{}, z1{}, z2{};
+    mask index, rotate;
+
+    // lane k takes lane k-1; lane 0 is overwritten with the next input
+    for (int k= 0; k < W; ++k) {
+        index[k]= k;
+        rotate[k]= (k + W - 1) % W;
+    }
+
+    for (size_t k= 0; k < count; ++k) {
+        b0[k]= stages[k].b0;
+        b1[k]= stages[k].b1;
+        b2[k]= stages[k].b2;
+        a1[k]= stages[k].a1;
+        a2[k]= stages[k].a2;
+        z1[k]= stages[k].z1;
+        z2[k]= stages[k].z2;
+    }
+
+    const long long length= n;
+    const long long fill= count - 1;
+    const long long steps= length + fill;
+    vec y{};
+
+    for (long long t= 0; t < steps; ++t) {
+        vec x= __builtin_shuffle(y, rotate);
+        x[0]= (t < length) ? in[t] : T(0.0);
+
+        y= b0 * x + z1;
+        vec s1= b1 * x - a1 * y + z2;
+        vec s2= b2 * x - a2 * y;
+
+        if (t >= fill && t < length) {
+            z1= s1;
+            z2= s2;
+        } else {
+            // ramp-up/drain: lane k only owns sample t - k while it is in
+            // the block, t - length < k <= t; both bounds are clamped to
+            // the lanes so they fit a lane
+            lane last= static_cast<lane>(min<long long>(t, W));
+            lane before= static_cast<lane>(max<long long>(t - length, -1));
+            mask active= (index <= last) & (index > before);
+            z1= active ? s1 : z1;
+            z2= active ? s2 : z2;
+        }
+
+        if (t >= fill)
+            out[t - fill]= y[fill];
+    }
+
+    for (size_t k= 0; k < count; ++k) {
+        stages[k].z1= z1[k];
+        stages[k].z2= z2[k];
+    }
+}
+
+template<int W, typename T>
+[[gnu::always_inline]] inline void cascadeVector(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n)
+{
+    for (size_t first= 0; first < count; first+= W) {
+        cascadeGroup<W>(stages + first, min<size_t>(W, count - first), in, out, n);
+        in= out;
+    }
+}
+
+// One channel per lane; stage-major so every stage's state stays in registers.
+template<int W, typename T>
+[[gnu::always_inline]] inline void bankVector(const vector<BasicBiquad<T>> &stages, T *z1s, T *z2s, size_t channels,
+    const T *in, T *out, size_t frames)
+{
+    using vec= typename Lanes<W, T>::vec;
+
+    for (size_t c= 0; c < channels; c+= W) {
+        size_t width= min<size_t>(W, channels - c) * sizeof(T);
+        const T *src= in;
+
+        for (size_t s= 0; s < stages.size(); ++s) {
+            const BasicBiquad<T> &bq= stages[s];
+            vec b0, b1, b2, a1, a2, z1{}, z2{};
+
+            for (int k= 0; k < W; ++k) {
+                b0[k]= bq.b0;
+                b1[k]= bq.b1;
+                b2[k]= bq.b2;
+                a1[k]= bq.a1;
+                a2[k]= bq.a2;
+            }
+
+            memcpy(&z1, z1s + s * channels + c, width);
+            memcpy(&z2, z2s + s * channels + c, width);
+
+            for (size_t f= 0; f < frames; ++f) {
+                vec x{};
+                memcpy(&x, src + f * channels + c, width);
+
+                vec y= b0 * x + z1;
+                z1= b1 * x - a1 * y + z2;
+                z2= b2 * x - a2 * y;
+
+                memcpy(out + f * channels + c, &y, width);
+            }
+
+            memcpy(z1s + s * channels + c, &z1, width);
+            memcpy(z2s + s * channels + c, &z2, width);
+            src= out;
+        }
+    }
+}
+
+#ifdef BIQUAD_X86
+template<typename T>
+void cascadeSse2(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n)
+{
+    cascadeVector<lanes<T, 16>>(stages, count, in, out, n);
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+void cascadeAvx2(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n)
+{
+    cascadeVector<lanes<T, 32>>(stages, count, in, out, n);
+}
+
+template<typename T>
+__attribute__((target("avx512f")))
+void cascadeAvx512(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n)
+{
+    cascadeVector<lanes<T, 64>>(stages, count, in, out, n);
+}
+
+template<typename T>
+void bankSse2(const vector<BasicBiquad<T>> &stages, T *z1, T *z2, size_t channels, const T *in, T *out, size_t frames)
+{
+    bankVector<lanes<T, 16>>(stages, z1, z2, channels, in, out, frames);
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+void bankAvx2(const vector<BasicBiquad<T>> &stages, T *z1, T *z2, size_t channels, const T *in, T *out, size_t frames)
+{
+    bankVector<lanes<T, 32>>(stages, z1, z2, channels, in, out, frames);
+}
+
+template<typename T>
+__attribute__((target("avx512f")))
+void bankAvx512(const vector<BasicBiquad<T>> &stages, T *z1, T *z2, size_t channels, const T *in, T *out, size_t frames)
+{
+    bankVector<lanes<T, 64>>(stages, z1, z2, channels, in, out, frames);
+}
+#endif
+
+} // namespace
+
+template<typename T>
+void processCascade(BasicBiquad<T> *stages, size_t count, const T *in, T *out, size_t n, SimdLevel level)
+{
+    // a single stage has nothing to pipeline
+    if (count < 2)
+        level= SimdLevel::SCALAR;
+
+    // lanes beyond the last stage only idle, and a wider vector steps no
+    // faster: take the narrowest level that still holds every stage
+    if (level == SimdLevel::AVX512 && count <= lanes<T, 32>)
+        level= SimdLevel::AVX2;
+    if (level == SimdLevel::AVX2 && count <= lanes<T, 16>)
+        level= SimdLevel::SSE2;
+
+    switch (level) {
+#ifdef BIQUAD_X86
+        case SimdLevel::SSE2:
+            cascadeSse2(stages, count, in, out, n);
+            return;
+        case SimdLevel::AVX2:
+            cascadeAvx2(stages, count, in, out, n);
+            return;
+        case SimdLevel::AVX512:
+            cascadeAvx512(stages, count, in, out, n);
+            return;
+#endif
+        default:
+            break;
+    }
+
+    for (size_t s= 0; s < count; ++s) {
+        stages[s].process(in, out, n);
+        in= out;
+    }
+
+    if (in != out)
+        copy(in, in + n, out);
+}
+
+template<typename T>
+void processCascade(vector<BasicBiquad<T>> &stages, const T *in, T *out, size_t n, SimdLevel level)
+{
+    processCascade(stages.data(), stages.size(), in, out, n, level);
+}
+
+template<typename T>
+BasicBiquadBank<T>::BasicBiquadBank(const vector<BasicBiquad<T>> &stages, size_t channels, SimdLevel level)
+    : stages_(stages), channels_(channels), level_(level),
+    z1_(stages.size() * channels), z2_(stages.size() * channels)
+{
+    if (channels_ == 0)
+        throw runtime_error("a biquad bank needs at least one channel");
+
+    for (size_t s= 0; s < stages_.size(); ++s) {
+        fill_n(z1_.begin() + s * channels_, channels_, stages_[s].z1);
+        fill_n(z2_.begin() + s * channels_, channels_, stages_[s].z2);
+    }
+}
+
+template<typename T>
+void BasicBiquadBank<T>::reset(size_t channel)
+{
+    for (size_t s= 0; s < stages_.size(); ++s) {
+        z1_[s * channels_ + channel]= stages_[s].z1;
+        z2_[s * channels_ + channel]= stages_[s].z2;
+    }
+}
+
+template<typename T>
+void BasicBiquadBank<T>::process(const T *in, T *out, size_t frames)
+{
+    if (stages_.empty()) {
+        if (in != out)
+            copy(in, in + frames * channels_, out);
+        return;
+    }
+
+    switch (level_) {
+#ifdef BIQUAD_X86
+        case SimdLevel::SSE2:
+            bankSse2(stages_, z1_.data(), z2_.data(), channels_, in, out, frames);
+            return;
+        case SimdLevel::AVX2:
+            bankAvx2(stages_, z1_.data(), z2_.data(), channels_, in, out, frames);
+            return;
+        case SimdLevel::AVX512:
+            bankAvx512(stages_, z1_.data(), z2_.data(), channels_, in, out, frames);
+            return;
+#endif
+        default:
+            break;
+    }
+
+    for (size_t c= 0; c < channels_; ++c) {
+        const T *src= in;
+
+        for (size_t s= 0; s < stages_.size(); ++s) {
+            const BasicBiquad<T> &bq= stages_[s];
+            T s1= z1_[s * channels_ + c];
+            T s2= z2_[s * channels_ + c];
+
+            for (size_t f= 0; f < frames; ++f) {
+                T x= src[f * channels_ + c];
+                T y= bq.b0 * x + s1;
+                s1= bq.b1 * x - bq.a1 * y + s2;
+                s2= bq.b2 * x - bq.a2 * y;
+                out[f * channels_ + c]= y;
+            }
+
+            z1_[s * channels_ + c]= s1;
+            z2_[s * channels_ + c]= s2;
+            src= out;
+        }
+    }
+}
+
+template struct BasicBiquad<double>;
+template struct BasicBiquad<float>;
+template void processCascade(Biquad *stages, size_t count, const double *in, double *out, size_t n, SimdLevel level);
+template void processCascade(BasicBiquad<float> *stages, size_t count, const float *in, float *out, size_t n,
+    SimdLevel level);
+template void processCascade(vector<Biquad> &stages, const double *in, double *out, size_t n, SimdLevel level);
+template void processCascade(vector<BasicBiquad<float>> &stages, const float *in, float *out, size_t n, SimdLevel level);
+template class BasicBiquadBank<double>;
+template class BasicBiquadBank<float>;
@@ -1,11 +1,8 @@
-#include <iostream>
-#include <cmath>
-#include <thread>
-#include <chrono>
-
-#include <argparse/argparse.hpp>
+#include <algorithm>
 
 #include "cv.hpp"
+#include "pacer.hpp"
+#include "stream.hpp"
 
 using namespace std;
 
@@ -14,50 +11,24 @@ Cv::Cv(double sampleRate, double amplitude) {
     amplitude_= amplitude;
 }
 
-void Cv::process(double duration) {
-
-    using clock= chrono::high_resolution_clock;
-    auto start= clock::now();
-    size_t totalSamples= static_cast<size_t>(duration * sampleRate_);
-
-    for(size_t i= 0; i < totalSamples; ++i) {
-
-        double sample= amplitude_;
-        std::cout << sample << '\n';
+void Cv::process(double *out, size_t n) {
 
-        auto next_time= start + chrono::duration<double>(i * (1.0 / sampleRate_));
-        while(clock::now() < next_time) {
-           // do nothing until we should process the next sample
-        }
-    }
+    fill(out, out + n, amplitude_);
 }
 
-int main(int argc, char *argv[]) {
-
-   double sampleRate;
-   double amplitude;
-   double duration;
-
-   argparse::ArgumentParser args("Cv");
-   args.add_argument("--sampleRate").default_value(48000.0).help("sampling rate").scan<'g', double>();
-   args.add_argument("--amplitude").default_value(1.0).help("amplitude").scan<'g', double>();
-   args.add_argument("--duration").default_value(1.0).help("duratione").scan<'g', double>();
+void Cv::process(double duration, SampleWriter &writer, Pacer &pacer, size_t blockSize) {
 
+    size_t totalSamples= static_cast<size_t>(duration * sampleRate_);
 
-   try {
-       args.parse_args(argc, argv);
-   } catch (const exception &err) {
-      cerr << err.what() << endl;
-      cerr << args;
-      return EXIT_FAILURE;
-   }
+    // the voltage is constant: a ctl stream gets runs rather than samples
+    for(size_t i= 0; i < totalSamples; i+= blockSize) {
 
-   sampleRate= args.get<double>("sampleRate");
-   amplitude= args.get<double>("amplitude");
-   duration= args.get<double>("duration");
+        size_t n= min(blockSize, totalSamples - i);
+        pacer.wait(n);
 
-   Cv cv(sampleRate, amplitude);
-   cv.process(duration);
+        writer.writeRun(&amplitude_, n);
 
-   return EXIT_SUCCESS;
+        if(pacer.flushEachBlock())
+            writer.flush();
+    }
 }
@@ -1,9 +1,4 @@
-#include <iostream>
-#include <exception>
-#include <thread>
-#include <chrono>
-
-#include <argparse/argparse.hpp>
+#include <algorithm>
 
 #include "env.hpp"
 
@@ -89,54 +84,41 @@ float ADSR::update() {
     return level;
 }
 
-int main(int argc, char **argv) {
+template<typename Sample>
+void ADSR::process(const Sample *gates, Sample *out, size_t n) {
 
-    argparse::ArgumentParser args("env");
-    string line;
-    bool lastGate= false;
+    for(size_t i= 0; i < n; ++i) {
+        bool high= (static_cast<float>(gates[i]) > 0.5f);
 
-    args.add_argument("--attack").default_value(0.01f).help("attack").scan<'g', float>();
-    args.add_argument("--decay").default_value(0.1f).help("decay").scan<'g', float>();
-    args.add_argument("--sustain").default_value(0.7f).help("sustain").scan<'g', float>();
-    args.add_argument("--release").default_value(0.3f).help("release").scan<'g', float>();
-    args.add_argument("--sample_rate").default_value(48000).help("sample_rate").scan<'i', int>();
+        if(high && !gate) {
+            note_on();
+        } else if(!high && gate) {
+            note_off();
+        }
 
-    try {
-        args.parse_args(argc, argv);
-    } catch (const exception &err) {
-       cerr << err.what() << endl;
-       cerr << args;
-       return EXIT_FAILURE;
+        gate= high;
+        out[i]= update();
     }
+}
 
-    float attack= args.get<float>("attack");
-    float decay= args.get<float>("decay");
-    float sustain= args.get<float>("sustain");
-    float release= args.get<float>("release");
-    int sampleRate= args.get<int>("sample_rate");
-
-    const auto sampleTime= chrono::microseconds(1000000 / sampleRate);
-    
- 
-    ADSR env {attack, decay, sustain, release, sampleRate};
-    env.note_on();
-    
-
-    while(getline(cin, line)) {
-        bool gate= (stof(line) > 0.5);
-
-        if(gate && !lastGate) {
-            env.note_on();
-        } else if(!gate && lastGate) {
-            env.note_off();
-        }
+template<typename Sample>
+void ADSR::process(double gateVoltage, Sample *out, size_t n) {
 
-        lastGate= gate;
- 
-        float sample= env.update();
-        cout << sample << "\n";
+    bool high= (static_cast<float>(gateVoltage) > 0.5f);
 
-        this_thread::sleep_for(sampleTime);
+    if(high && !gate) {
+        note_on();
+    } else if(!high && gate) {
+        note_off();
     }
-    return EXIT_SUCCESS;
-} 
+
+    gate= high;
+
+    for(size_t i= 0; i < n; ++i)
+        out[i]= update();
+}
+
+template void ADSR::process(const double *gates, double *out, size_t n);
+template void ADSR::process(const float *gates, float *out, size_t n);
+template void ADSR::process(double gateVoltage, double *out, size_t n);
+template void ADSR::process(double gateVoltage, float *out, size_t n);
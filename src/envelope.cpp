@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+
+#include "envelope.hpp"
+
+using namespace std;
+
+// The reductions are written as plain selects over contiguous arrays so the
+// compiler turns each one into packed min/max instructions.
+void Envelope::set(const float *samples, size_t count)
+{
+    samples_.assign(samples, samples + count);
+
+    size_t levels= 0;
+    for (size_t n= count / 2; n > 0; n/= 2)
+        ++levels;
+    levels_.resize(levels);
+
+    size_t n= count / 2;
+    if (levels > 0) {
+        Level &first= levels_[0];
+        first.min.resize(n);
+        first.max.resize(n);
+        first.squares.resize(n);
+
+        const float *s= samples_.data();
+        for (size_t i= 0; i < n; ++i) {
+            float a= s[2 * i];
+            float b= s[2 * i + 1];
+            first.min[i]= a < b ? a : b;
+            first.max[i]= a > b ? a : b;
+            first.squares[i]= static_cast<double>(a) * a + static_cast<double>(b) * b;
+        }
+    }
+
+    for (size_t k= 1; k < levels; ++k) {
+        const Level &below= levels_[k - 1];
+        Level &level= levels_[k];
+        n/= 2;
+
+        level.min.resize(n);
+        level.max.resize(n);
+        level.squares.resize(n);
+
+        for (size_t i= 0; i < n; ++i) {
+            float a= below.min[2 * i];
+            float b= below.min[2 * i + 1];
+            level.min[i]= a < b ? a : b;
+        }
+        for (size_t i= 0; i < n; ++i) {
+            float a= below.max[2 * i];
+            float b= below.max[2 * i + 1];
+            level.max[i]= a > b ? a : b;
+        }
+        for (size_t i= 0; i < n; ++i)
+            level.squares[i]= below.squares[2 * i] + below.squares[2 * i + 1];
+    }
+}
+
+// Classic bottom-up segment walk: an odd boundary node is taken at the
+// current level, the rest is covered by whole nodes of the level above.
+Envelope::Column Envelope::range(size_t first, size_t last) const
+{
+    size_t count= last - first;
+    float low= samples_[first];
+    float high= samples_[first];
+    double squares= 0.0;
+
+    if (first & 1) {
+        float s= samples_[first++];
+        squares+= static_cast<double>(s) * s;
+    }
+    if (last & 1) {
+        float s= samples_[--last];
+        low= min(low, s);
+        high= max(high, s);
+        squares+= static_cast<double>(s) * s;
+    }
+
+    first/= 2;
+    last/= 2;
+
+    for (size_t k= 0; first < last; ++k) {
+        const Level &level= levels_[k];
+
+        if (first & 1) {
+            low= min(low, level.min[first]);
+            high= max(high, level.max[first]);
+            squares+= level.squares[first++];
+        }
+        if (last & 1) {
+            --last;
+            low= min(low, level.min[last]);
+            high= max(high, level.max[last]);
+            squares+= level.squares[last];
+        }
+
+        first/= 2;
+        last/= 2;
+    }
+
+    return { low, high, static_cast<float>(sqrt(squares / count)) };
+}
+
+void Envelope::columns(size_t first, size_t count, Column *out, size_t width) const
+{
+    size_t end= min(first + count, samples_.size());
+
+    if (first >= end) {
+        fill(out, out + width, Column{ 0.0f, 0.0f, 0.0f });
+        return;
+    }
+
+    for (size_t x= 0; x < width; ++x) {
+        size_t a= first + x * count / width;
+        size_t b= first + (x + 1) * count / width + 1;
+
+        a= min(a, end - 1);
+        b= clamp(b, a + 1, end);
+        out[x]= range(a, b);
+    }
+}
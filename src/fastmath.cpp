@@ -0,0 +1,31 @@
+#include <stdexcept>
+
+#include "fastmath.hpp"
+
+using namespace std;
+
+Precision parsePrecision(const string &s)
+{
+    if (s == "low")
+        return Precision::LOW;
+
+    if (s == "high")
+        return Precision::HIGH;
+
+    if (s == "full")
+        return Precision::FULL;
+
+    throw runtime_error("precision must be 'low', 'high' or 'full'");
+}
+
+const char *precisionName(Precision precision)
+{
+    switch (precision) {
+        case Precision::LOW:
+            return "low";
+        case Precision::HIGH:
+            return "high";
+        default:
+            return "full";
+    }
+}
@@ -0,0 +1,97 @@
+#include <cmath>
+#include <stdexcept>
+
+#include "fft.hpp"
+
+using namespace std;
+
+Fft::Fft(size_t size)
+    : size_(size)
+{
+    if (size < 4 || (size & (size - 1)) != 0)
+        throw runtime_error("FFT size must be a power of two of at least 4");
+
+    size_t m= size / 2;
+    size_t bits= 0;
+    while ((size_t(1) << bits) < m)
+        ++bits;
+
+    reverse_.resize(m);
+    for (size_t i= 0; i < m; ++i) {
+        uint32_t r= 0;
+        for (size_t b= 0; b < bits; ++b)
+            r|= ((i >> b) & 1) << (bits - 1 - b);
+        reverse_[i]= r;
+    }
+
+    // stage with butterflies of span len uses len/2 twiddles
+    for (size_t len= 2; len <= m; len*= 2) {
+        for (size_t j= 0; j < len / 2; ++j) {
+            double phase= -2.0 * M_PI * j / len;
+            twiddleRe_.push_back(cos(phase));
+            twiddleIm_.push_back(sin(phase));
+        }
+    }
+
+    for (size_t k= 0; k <= m; ++k) {
+        double phase= -2.0 * M_PI * k / size;
+        splitRe_.push_back(cos(phase));
+        splitIm_.push_back(sin(phase));
+    }
+
+    workRe_.resize(m);
+    workIm_.resize(m);
+}
+
+void Fft::forward(const float *in, float *re, float *im)
+{
+    size_t m= size_ / 2;
+    float *zr= workRe_.data();
+    float *zi= workIm_.data();
+
+    for (size_t i= 0; i < m; ++i) {
+        zr[reverse_[i]]= in[2 * i];
+        zi[reverse_[i]]= in[2 * i + 1];
+    }
+
+    const float *wr= twiddleRe_.data();
+    const float *wi= twiddleIm_.data();
+
+    for (size_t len= 2; len <= m; len*= 2) {
+        size_t half= len / 2;
+
+        for (size_t i= 0; i < m; i+= len) {
+            float *ar= zr + i;
+            float *ai= zi + i;
+            float *br= zr + i + half;
+            float *bi= zi + i + half;
+
+            for (size_t j= 0; j < half; ++j) {
+                float tr= wr[j] * br[j] - wi[j] * bi[j];
+                float ti= wr[j] * bi[j] + wi[j] * br[j];
+                br[j]= ar[j] - tr;
+                bi[j]= ai[j] - ti;
+                ar[j]+= tr;
+                ai[j]+= ti;
+            }
+        }
+
+        wr+= half;
+        wi+= half;
+    }
+
+    // X[k] = E[k] + W^k O[k], with E and O the transforms of the even and
+    // odd samples recovered from Z[k] and conj(Z[m - k])
+    for (size_t k= 0; k <= m; ++k) {
+        size_t a= k % m;
+        size_t b= (m - k) % m;
+
+        float er= 0.5f * (zr[a] + zr[b]);
+        float ei= 0.5f * (zi[a] - zi[b]);
+        float or_= 0.5f * (zi[a] + zi[b]);
+        float oi= -0.5f * (zr[a] - zr[b]);
+
+        re[k]= er + splitRe_[k] * or_ - splitIm_[k] * oi;
+        im[k]= ei + splitRe_[k] * oi + splitIm_[k] * or_;
+    }
+}
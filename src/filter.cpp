@@ -1,13 +1,53 @@
-#include <iostream>
-#include <argparse/argparse.hpp>
+#include <algorithm>
 #include <cmath>
+#include <type_traits>
 
 #include "filter.hpp"
 
 using namespace std;
 
-Filter::Filter(double fs, Type type, double fc, int rolloff_db)
-    : fs_(fs)
+static constexpr double butterworthQ= sqrt(2.0) / 2.0;
+
+// the modulated cutoff's table: its lowest frequency, steps per octave,
+// and how close to Nyquist it goes
+static constexpr double warpLowest= 10.0;
+static constexpr int warpSteps= 64;
+static constexpr double warpHighest= 0.49;
+
+// samples of the modulated version that share one pass of the cascade
+static constexpr size_t modulationChunk= 64;
+
+// the lowest cutoff, as a fraction of the sample rate, at which a float
+// filter runs its cascade in float, and the samples converted at a time
+// below it
+static constexpr double narrowLowest= 0.01;
+static constexpr size_t wideChunk= 256;
+
+// the transcendental functions of the design, at one precision
+struct DesignMath {
+    double (*sin)(double);
+    double (*tan)(double);
+    double (*exp)(double);
+};
+
+template<Precision P>
+static constexpr DesignMath designMath{ fastmath::sin<P>, fastmath::tan<P>, fastmath::exp<P> };
+
+static const DesignMath &selectDesignMath(Precision precision)
+{
+    switch (precision) {
+        case Precision::LOW:
+            return designMath<Precision::LOW>;
+        case Precision::HIGH:
+            return designMath<Precision::HIGH>;
+        default:
+            return designMath<Precision::FULL>;
+    }
+}
+
+template<typename Sample>
+BasicFilter<Sample>::BasicFilter(double fs, Type type, double fc, int rolloff_db, SimdLevel simd, Precision precision)
+    : fs_(fs), type_(type), simd_(simd), precision_(precision), narrow_(false)
 {
     int order= rolloff_db / 6;
     bool odd= order & 1;
@@ -21,29 +61,57 @@ Filter::Filter(double fs, Type type, double fc, int rolloff_db)
 
     for (int i= 0; i < n_biquads; ++i)
         biquads_.push_back(computeBiquad(type, fc));
+
+    svfs_.resize(n_biquads);
+
+    if constexpr (!is_same_v<Sample, double>) {
+        narrow_= fc >= narrowLowest * fs_;
+
+        if (narrow_) {
+            if (first_)
+                narrowFirst_.emplace(FirstOrder<Sample>{ Sample(first_->b0), Sample(first_->b1), Sample(first_->a1) });
+            for (const auto &bq : biquads_)
+                narrowBiquads_.push_back(bq.template to<Sample>());
+        }
+    }
+
+    // Interpolating linearly between entries 1/64 octave apart moves the
+    // cutoff by under 0.004% up to fs/4; tan() bends sharply towards
+    // Nyquist, where it reaches 0.13%. The last entry lies less than a
+    // step above warpHighest.
+    double octaves= max(log2(warpHighest * fs_ / warpLowest), 1.0);
+    size_t entries= static_cast<size_t>(ceil(octaves * warpSteps)) + 1;
+    const DesignMath &math= selectDesignMath(precision_);
+    for (size_t i= 0; i < entries; ++i)
+        warp_.push_back(math.tan(M_PI * warpLowest * math.exp(M_LN2 * i / warpSteps) / fs_));
+    octave_= log2(fc / warpLowest);
 }
 
-Filter::Biquad Filter::computeBiquad(Type type, double fc) const
+template<typename Sample>
+Biquad BasicFilter<Sample>::computeBiquad(Type type, double fc) const
 {
-    static constexpr double Q= sqrt(2.0) / 2.0;
+    // 1 - cos w0 as 2 sin^2(w0 / 2): at low cutoffs cos w0 is close to 1,
+    // and the difference would lose the relative accuracy of the sine
+    const DesignMath &math= selectDesignMath(precision_);
     double w0= 2.0 * M_PI * fc / fs_;
-    double sinW= std::sin(w0);
-    double cosW= std::cos(w0);
-    double alpha= sinW / (2.0 * Q);
+    double sinHalf= math.sin(0.5 * w0);
+    double versine= 2.0 * sinHalf * sinHalf;
+    double sinW= math.sin(w0);
+    double alpha= sinW / (2.0 * butterworthQ);
     double b0, b1, b2, a0, a1, a2;
 
     if (type == Type::LOWPASS) {
-        b0= (1.0 - cosW) / 2.0;
-        b1= 1.0 - cosW;
-        b2= (1.0 - cosW) / 2.0;
+        b0= versine / 2.0;
+        b1= versine;
+        b2= versine / 2.0;
     } else {
-        b0= (1.0 + cosW) / 2.0;
-        b1= -(1.0 + cosW);
-        b2= (1.0 + cosW) / 2.0;
+        b0= (2.0 - versine) / 2.0;
+        b1= -(2.0 - versine);
+        b2= (2.0 - versine) / 2.0;
     }
 
     a0= 1.0 + alpha;
-    a1= -2.0 * cosW;
+    a1= -2.0 * (1.0 - versine);
     a2= 1.0 - alpha;
 
     Biquad bq;
@@ -56,11 +124,12 @@ Filter::Biquad Filter::computeBiquad(Type type, double fc) const
     return bq;
 }
 
-Filter::FirstOrder Filter::computeFirstOrder(Type type, double fc) const
+template<typename Sample>
+auto BasicFilter<Sample>::computeFirstOrder(Type type, double fc) const -> FirstOrder<double>
 {
-    double w0= std::tan(M_PI * fc / fs_);
+    double w0= selectDesignMath(precision_).tan(M_PI * fc / fs_);
     double a0= 1.0 + w0;
-    FirstOrder f;
+    FirstOrder<double> f;
 
     if (type == Type::LOWPASS) {
         f.b0= w0 / a0;
@@ -75,84 +144,219 @@ Filter::FirstOrder Filter::computeFirstOrder(Type type, double fc) const
 }
 
 
-double Filter::Biquad::process(double x)
+template<typename Sample>
+template<typename T>
+T BasicFilter<Sample>::FirstOrder<T>::process(T x)
 {
-    double y= b0 * x + z1;
-    z1= b1 * x - a1 * y + z2;
-    z2= b2 * x - a2 * y;
+    T y= b0 * x + z1;
+    z1= b1 * x - a1 * y;
 
     return y;
 }
 
-double Filter::FirstOrder::process(double x)
+template<typename Sample>
+Sample BasicFilter<Sample>::process(Sample x)
 {
-    double y= b0 * x + z1;
-    z1= b1 * x - a1 * y;
+    if (narrow_) {
+        if (narrowFirst_)
+            x= narrowFirst_->process(x);
 
-    return y;
-}
+        for (auto &bq : narrowBiquads_)
+            x= bq.process(x);
+
+        return x;
+    }
+
+    double y= x;
 
-double Filter::process(double x)
-{
     if (first_)
-        x= first_->process(x);
+        y= first_->process(y);
 
     for (auto &bq : biquads_)
-        x= bq.process(x);
+        y= bq.process(y);
 
-    return x;
+    return static_cast<Sample>(y);
 }
 
-Filter::Type parseFilterType(const string &s)
+// Block versions run one stage (or one SIMD group of stages) over the whole
+// block before moving to the next. Every stage sees the same input sequence
+// as in the per-sample cascade, so the output is identical.
+template<typename Sample>
+template<typename T>
+void BasicFilter<Sample>::FirstOrder<T>::process(const T *in, T *out, size_t n)
 {
-    if (s == "lowpass")
-        return Filter::Type::LOWPASS;
+    T s1= z1;
 
-    if (s == "highpass") 
-        return Filter::Type::HIGHPASS;
+    for (size_t i= 0; i < n; ++i) {
+        T x= in[i];
+        T y= b0 * x + s1;
+        s1= b1 * x - a1 * y;
+        out[i]= y;
+    }
 
-    throw runtime_error("filter_type must be 'lowpass' or 'highpass'");
+    z1= s1;
 }
 
+template<typename Sample>
+void BasicFilter<Sample>::processWide(const double *in, double *out, size_t n)
+{
+    if (first_) {
+        first_->process(in, out, n);
+        in= out;
+    }
 
-int main(int argc, char *argv[])
+    processCascade(biquads_, in, out, n, simd_);
+}
+
+template<typename Sample>
+void BasicFilter<Sample>::process(const Sample *in, Sample *out, size_t n)
 {
-    argparse::ArgumentParser args("Filter");
-    args.add_argument("--filter_type").default_value(string("lowpass")).help("lowpass | highpass").action([](const string &v){ return v; });
-    args.add_argument("--cutoff").required().help("cutoff frequency in Hz") .scan<'g',double>();
-    args.add_argument("--rolloff").default_value(12).help("rolloff in dB/oct (multiple of 6)").scan<'i', int>();
-    args.add_argument("--sample_rate").default_value(48000.0).help("sampling rate (Hz)").scan<'g', double>();
-
-    string line;
-    double sample;
-
-    try {
-        args.parse_args(argc, argv);
-    } catch (const exception &e) {
-        cerr << e.what() << endl << args << endl;
-        return EXIT_FAILURE;
+    if constexpr (is_same_v<Sample, double>) {
+        processWide(in, out, n);
+    } else if (narrow_) {
+        if (narrowFirst_) {
+            narrowFirst_->process(in, out, n);
+            in= out;
+        }
+
+        processCascade(narrowBiquads_, in, out, n, simd_);
+    } else {
+        double wide[wideChunk];
+
+        for (size_t begin= 0; begin < n; begin+= wideChunk) {
+            size_t m= min(wideChunk, n - begin);
+            copy(in + begin, in + begin + m, wide);
+            processWide(wide, wide, m);
+            copy(wide, wide + m, out + begin);
+        }
     }
+}
 
-    const auto type= parseFilterType(args.get<string>("filter_type"));
-    const auto cutoff= args.get<double>("cutoff");
-    const auto rolloff_db= args.get<int>("rolloff");
-    const auto fs= args.get<double>("sample_rate");
-    if (rolloff_db % 6 != 0) {
-        cerr << "rolloff must be an integer multiple of 6 dB" << endl;
-        return EXIT_FAILURE;
+// tan(pi f / fs) for f the given octaves above warpLowest, clamped to the
+// table's range
+template<typename Sample>
+double BasicFilter<Sample>::warp(double octave) const
+{
+    double position= clamp(octave * warpSteps, 0.0, static_cast<double>(warp_.size() - 1));
+    size_t i= min(static_cast<size_t>(position), warp_.size() - 2);
+    double frac= position - i;
+
+    return warp_[i] + (warp_[i + 1] - warp_[i]) * frac;
+}
+
+// Zavalishin's TPT state-variable filter, as formulated by Simper
+template<typename Sample>
+void BasicFilter<Sample>::Svf::process(Type type, const double *in, double *out, size_t n, const SvfCoefficients *coefficients)
+{
+    double s1= ic1;
+    double s2= ic2;
+
+    for (size_t i= 0; i < n; ++i) {
+        const auto &c= coefficients[i];
+        double v0= in[i];
+        double v3= v0 - s2;
+        double v1= c.a1 * s1 + c.a2 * v3;
+        double v2= s2 + c.a2 * s1 + c.a3 * v3;
+        s1= 2.0 * v1 - s1;
+        s2= 2.0 * v2 - s2;
+
+        out[i]= (type == Type::LOWPASS) ? v2 : v0 - c.k * v1 - v2;
     }
 
-    Filter filter(fs, type, cutoff, rolloff_db);
+    ic1= s1;
+    ic2= s2;
+}
 
-    while (std::getline(cin, line)) {
-        istringstream iss(line);
-        if (iss >> sample) {
-            cout << filter.process(sample) << '\n';
+// Works through the block in chunks: the coefficients of each sample are
+// computed once per chunk from the prewarped cutoff gain g and the damping
+// k = 1/Q, then every section runs over it. Float samples are converted a
+// chunk at a time.
+template<typename Sample>
+void BasicFilter<Sample>::process(const Sample *in, const Sample *cutoffCv, const Sample *q, Sample *out, size_t n)
+{
+    SvfCoefficients coefficients[modulationChunk];
+    double onePole[modulationChunk];
+    [[maybe_unused]] double wideIn[modulationChunk], wideOut[modulationChunk];
+
+    for (size_t begin= 0; begin < n; begin+= modulationChunk) {
+        size_t m= min(modulationChunk, n - begin);
+        const double *x;
+        double *y;
+
+        if constexpr (is_same_v<Sample, double>) {
+            x= in + begin;
+            y= out + begin;
         } else {
-            cerr << "Skipping non-numeric line: " << line << endl;
+            copy(in + begin, in + begin + m, wideIn);
+            x= wideIn;
+            y= wideOut;
         }
-    }    
 
-    return EXIT_SUCCESS;
+        for (size_t i= 0; i < m; ++i) {
+            double g= cutoffCv ? warp(octave_ + cutoffCv[begin + i]) : warp(octave_);
+            double k= 1.0 / (q ? max<double>(q[begin + i], 0.01) : butterworthQ);
+            double a1= 1.0 / (1.0 + g * (g + k));
+            coefficients[i]= { a1, g * a1, g * g * a1, k };
+            onePole[i]= g / (1.0 + g);
+        }
+
+        // one-pole TPT section
+        if (first_) {
+            double s= onePole_;
+            for (size_t i= 0; i < m; ++i) {
+                double v= (x[i] - s) * onePole[i];
+                double lowpass= v + s;
+                s= lowpass + v;
+                y[i]= (type_ == Type::LOWPASS) ? lowpass : x[i] - lowpass;
+            }
+            onePole_= s;
+            x= y;
+        }
+
+        for (auto &svf : svfs_) {
+            svf.process(type_, x, y, m, coefficients);
+            x= y;
+        }
+
+        if (x != y)
+            copy(x, x + m, y);
+
+        if constexpr (!is_same_v<Sample, double>)
+            copy(y, y + m, out + begin);
+    }
+}
+
+template<typename Sample>
+vector<Biquad> BasicFilter<Sample>::sections() const
+{
+    vector<Biquad> sections;
+
+    if (first_) {
+        Biquad bq;
+        bq.b0= first_->b0;
+        bq.b1= first_->b1;
+        bq.b2= 0.0;
+        bq.a1= first_->a1;
+        bq.a2= 0.0;
+        bq.z1= first_->z1;
+        sections.push_back(bq);
+    }
+
+    sections.insert(sections.end(), biquads_.begin(), biquads_.end());
+
+    return sections;
+}
+
+Filter::Type parseFilterType(const string &s)
+{
+    if (s == "lowpass")
+        return Filter::Type::LOWPASS;
+
+    if (s == "highpass") 
+        return Filter::Type::HIGHPASS;
+
+    throw runtime_error("filter_type must be 'lowpass' or 'highpass'");
 }
 
+template class BasicFilter<double>;
+template class BasicFilter<float>;
@@ -0,0 +1,53 @@
+#include "filtercascade.hpp"
+
+namespace {
+
+// any other order, as the runtime cascade
+class GenericCascade final : public Cascade {
+public:
+    GenericCascade(double fs, FilterTypes::Type type, double fc, int rolloff_db, SimdLevel simd, Precision precision)
+        : filter_(fs, type, fc, rolloff_db, simd, precision) {}
+
+    double process(double x) override {
+        return filter_.process(x);
+    }
+
+    void process(const double *in, double *out, size_t n) override {
+        filter_.process(in, out, n);
+    }
+
+private:
+    Filter filter_;
+};
+
+typedef unique_ptr<Cascade> (*CascadeMaker)(double fs, double fc, SimdLevel simd, Precision precision);
+
+template<int Order, FilterTypes::Type Kind>
+unique_ptr<Cascade> makeCascade(double fs, double fc, SimdLevel simd, Precision precision)
+{
+    return make_unique<FilterCascade<Order, Kind>>(fs, fc, simd, precision);
+}
+
+// entry i builds order i + 1
+template<FilterTypes::Type Kind, size_t... I>
+constexpr array<CascadeMaker, sizeof...(I)> cascadeMakers(index_sequence<I...>)
+{
+    return { makeCascade<I + 1, Kind>... };
+}
+
+constexpr auto lowpassMakers= cascadeMakers<FilterTypes::Type::LOWPASS>(make_index_sequence<maxCascadeOrder>{});
+constexpr auto highpassMakers= cascadeMakers<FilterTypes::Type::HIGHPASS>(make_index_sequence<maxCascadeOrder>{});
+
+} // namespace
+
+unique_ptr<Cascade> makeFilterCascade(double fs, FilterTypes::Type type, double fc, int rolloff_db, SimdLevel simd,
+    Precision precision)
+{
+    int order= rolloff_db / 6;
+
+    if (order < 1 || order > maxCascadeOrder)
+        return make_unique<GenericCascade>(fs, type, fc, rolloff_db, simd, precision);
+
+    const auto &makers= type == FilterTypes::Type::LOWPASS ? lowpassMakers : highpassMakers;
+    return makers[order - 1](fs, fc, simd, precision);
+}
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "framewriter.hpp"
+
+using namespace std;
+
+namespace {
+
+array<uint32_t, 256> crcTable() {
+    array<uint32_t, 256> table;
+    for (uint32_t n= 0; n < 256; ++n) {
+        uint32_t c= n;
+        for (int k= 0; k < 8; ++k)
+            c= (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[n]= c;
+    }
+    return table;
+}
+
+uint32_t crc32(const uint8_t *data, size_t size) {
+    static const array<uint32_t, 256> table= crcTable();
+    uint32_t c= 0xFFFFFFFFu;
+    for (size_t i= 0; i < size; ++i)
+        c= table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+void putBigEndian(vector<uint8_t> &out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+// appends a PNG chunk: length, type, data, CRC over type and data
+void putChunk(vector<uint8_t> &out, const char *type, const vector<uint8_t> &data) {
+    putBigEndian(out, data.size());
+    size_t start= out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+} // namespace
+
+FrameWriter::FrameWriter(const string &path, Type type, int width, int height)
+    : path_(path), type_(type), width_(width), height_(height),
+    numbered_(path.find('%') != string::npos), stream_(nullptr), frames_(0)
+{
+    if (numbered_)
+        return;
+
+    stream_= (path_ == "-") ? stdout : fopen(path_.c_str(), "wb");
+    if (stream_ == nullptr)
+        throw runtime_error("cannot open " + path_ + ": " + strerror(errno));
+}
+
+FrameWriter::~FrameWriter()
+{
+    if (stream_ == stdout)
+        fflush(stream_);
+    else if (stream_ != nullptr)
+        fclose(stream_);
+}
+
+void FrameWriter::write(const uint32_t *pixels, int pitch)
+{
+    bytes_.clear();
+
+    switch (type_) {
+        case Type::PPM:
+            encodePpm(pixels, pitch);
+            break;
+        case Type::PNG:
+            encodePng(pixels, pitch);
+            break;
+        case Type::RGBA:
+            encodeRgba(pixels, pitch);
+            break;
+    }
+
+    FILE *out= stream_;
+    string name= path_;
+
+    if (numbered_) {
+        char buffer[4096];
+        snprintf(buffer, sizeof(buffer), path_.c_str(), static_cast<int>(frames_));
+        name= buffer;
+        out= fopen(name.c_str(), "wb");
+        if (out == nullptr)
+            throw runtime_error("cannot open " + name + ": " + strerror(errno));
+    }
+
+    bool ok= fwrite(bytes_.data(), 1, bytes_.size(), out) == bytes_.size();
+
+    if (numbered_)
+        ok= (fclose(out) == 0) && ok;
+
+    if (!ok)
+        throw runtime_error("writing frame to " + name + ": " + strerror(errno));
+
+    ++frames_;
+}
+
+void FrameWriter::encodePpm(const uint32_t *pixels, int pitch)
+{
+    string header= "P6\n" + to_string(width_) + " " + to_string(height_) + "\n255\n";
+    bytes_.assign(header.begin(), header.end());
+
+    for (int y= 0; y < height_; ++y) {
+        for (int x= 0; x < width_; ++x) {
+            uint32_t p= pixels[y * pitch + x];
+            bytes_.push_back(p >> 16);
+            bytes_.push_back(p >> 8);
+            bytes_.push_back(p);
+        }
+    }
+}
+
+void FrameWriter::encodeRgba(const uint32_t *pixels, int pitch)
+{
+    bytes_.resize(static_cast<size_t>(width_) * height_ * 4);
+    uint8_t *out= bytes_.data();
+
+    for (int y= 0; y < height_; ++y) {
+        for (int x= 0; x < width_; ++x) {
+            uint32_t p= pixels[y * pitch + x];
+            *out++= p >> 16;
+            *out++= p >> 8;
+            *out++= p;
+            *out++= 0xFF;
+        }
+    }
+}
+
+// 8-bit RGB with stored (uncompressed) deflate blocks: no zlib needed, and
+// frames are written as fast as they are drawn
+void FrameWriter::encodePng(const uint32_t *pixels, int pitch)
+{
+    static const uint8_t signature[8]= { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    bytes_.assign(signature, signature + 8);
+
+    vector<uint8_t> header;
+    putBigEndian(header, width_);
+    putBigEndian(header, height_);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });     // depth, RGB, deflate, no filter, no interlace
+    putChunk(bytes_, "IHDR", header);
+
+    // scanlines, each behind a "no filter" byte
+    vector<uint8_t> raw;
+    raw.reserve(static_cast<size_t>(height_) * (width_ * 3 + 1));
+    for (int y= 0; y < height_; ++y) {
+        raw.push_back(0);
+        for (int x= 0; x < width_; ++x) {
+            uint32_t p= pixels[y * pitch + x];
+            raw.push_back(p >> 16);
+            raw.push_back(p >> 8);
+            raw.push_back(p);
+        }
+    }
+
+    vector<uint8_t> zlib= { 0x78, 0x01 };
+    for (size_t offset= 0; ; ) {
+        size_t size= min<size_t>(raw.size() - offset, 65535);
+        bool last= (offset + size == raw.size());
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(size);
+        zlib.push_back(size >> 8);
+        zlib.push_back(~size);
+        zlib.push_back(~size >> 8);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+
+        offset+= size;
+        if (last)
+            break;
+    }
+
+    // Adler-32, reduced every 5552 bytes (the most that cannot overflow)
+    uint32_t a= 1, b= 0;
+    for (size_t offset= 0; offset < raw.size(); offset+= 5552) {
+        size_t end= min<size_t>(offset + 5552, raw.size());
+        for (size_t i= offset; i < end; ++i) {
+            a+= raw[i];
+            b+= a;
+        }
+        a%= 65521;
+        b%= 65521;
+    }
+    putBigEndian(zlib, (b << 16) | a);
+
+    putChunk(bytes_, "IDAT", zlib);
+    putChunk(bytes_, "IEND", {});
+}
+
+FrameWriter::Type parseFrameType(const string &s)
+{
+    if (s == "ppm")
+        return FrameWriter::Type::PPM;
+
+    if (s == "png")
+        return FrameWriter::Type::PNG;
+
+    if (s == "rgba")
+        return FrameWriter::Type::RGBA;
+
+    throw runtime_error("output_format must be 'ppm', 'png' or 'rgba'");
+}
@@ -0,0 +1,87 @@
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+
+#include "pacer.hpp"
+
+using namespace std;
+
+static constexpr int64_t nsPerSecond= 1000000000;
+
+static int64_t toNs(const timespec &ts)
+{
+    return static_cast<int64_t>(ts.tv_sec) * nsPerSecond + ts.tv_nsec;
+}
+
+static timespec fromNs(int64_t ns)
+{
+    timespec ts;
+    ts.tv_sec= ns / nsPerSecond;
+    ts.tv_nsec= ns % nsPerSecond;
+    return ts;
+}
+
+Pacer::Pacer(Mode mode, double sampleRate)
+    : mode_(mode), nsPerSample_(nsPerSecond / sampleRate), start_{}, started_(false),
+    samples_(0), blocks_(0), lateBlocks_(0), maxDrift_(0.0), lastBlockSeconds_(0.0)
+{
+}
+
+void Pacer::wait(size_t samples)
+{
+    if (mode_ != Mode::REALTIME)
+        return;
+
+    if (!started_) {
+        clock_gettime(CLOCK_MONOTONIC, &start_);
+        started_= true;
+    }
+
+    int64_t deadline= toNs(start_) + static_cast<int64_t>(samples_ * nsPerSample_);
+    timespec ts= fromNs(deadline);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        // interrupted by a signal, the deadline is still absolute
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double drift= static_cast<double>(toNs(now) - deadline) / nsPerSecond;
+
+    if (drift > maxDrift_)
+        maxDrift_= drift;
+
+    // late by more than the previous block: we are not keeping up
+    if (blocks_ > 0 && drift > lastBlockSeconds_)
+        ++lateBlocks_;
+
+    lastBlockSeconds_= samples * nsPerSample_ / nsPerSecond;
+    samples_+= samples;
+    ++blocks_;
+}
+
+void Pacer::report(const string &name) const
+{
+    if (mode_ != Mode::REALTIME || blocks_ == 0)
+        return;
+
+    cerr << name << ": realtime pacing, " << blocks_ << " blocks, max drift "
+        << maxDrift_ * 1000.0 << " ms, " << lateBlocks_ << " late" << endl;
+}
+
+Pacer::Mode parsePacing(bool realtime, bool offline, bool downstream, Pacer::Mode fallback)
+{
+    if (realtime + offline + downstream > 1)
+        throw runtime_error("--realtime, --offline and --clock-from-downstream are mutually exclusive");
+
+    if (realtime)
+        return Pacer::Mode::REALTIME;
+
+    if (offline)
+        return Pacer::Mode::OFFLINE;
+
+    if (downstream)
+        return Pacer::Mode::DOWNSTREAM;
+
+    return fallback;
+}
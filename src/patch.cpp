@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <argparse/argparse.hpp>
+
+#include "patch.hpp"
+#include "cv.hpp"
+#include "vco.hpp"
+#include "filter.hpp"
+#include "filtercascade.hpp"
+#include "env.hpp"
+
+using namespace std;
+
+namespace {
+
+class CvNode : public Node {
+public:
+    CvNode(double sampleRate, double amplitude, double duration)
+        : cv_(sampleRate, amplitude), sampleRate_(sampleRate),
+        remaining_(static_cast<size_t>(duration * sampleRate)) {}
+
+    size_t process(double *block, size_t n) override {
+        n= min(n, remaining_);
+        cv_.process(block, n);
+        remaining_-= n;
+        return n;
+    }
+
+    bool isSource() const override {
+        return true;
+    }
+
+    double sampleRate() const override {
+        return sampleRate_;
+    }
+
+private:
+    Cv cv_;
+    double sampleRate_;
+    size_t remaining_;
+};
+
+class VcoNode : public Node {
+public:
+    VcoNode(double sampleRate, double sensitivity, double amplitude, Vco::WaveType waveType, Vco::Engine engine,
+        Precision precision)
+        : vco_(sampleRate, sensitivity, amplitude, engine, precision), waveType_(waveType), sampleRate_(sampleRate) {}
+
+    size_t process(double *block, size_t n) override {
+        vco_.generateWaveForm(block, block, n, waveType_);
+        return n;
+    }
+
+    double sampleRate() const override {
+        return sampleRate_;
+    }
+
+private:
+    Vco vco_;
+    Vco::WaveType waveType_;
+    double sampleRate_;
+};
+
+class FilterNode : public Node {
+public:
+    FilterNode(double fs, Filter::Type type, double cutoff, int rolloff_db, Precision precision)
+        : filter_(makeFilterCascade(fs, type, cutoff, rolloff_db, detectSimd(), precision)), fs_(fs) {}
+
+    size_t process(double *block, size_t n) override {
+        filter_->process(block, block, n);
+        return n;
+    }
+
+    double sampleRate() const override {
+        return fs_;
+    }
+
+private:
+    unique_ptr<Cascade> filter_;
+    double fs_;
+};
+
+class EnvNode : public Node {
+public:
+    EnvNode(float attack, float decay, float sustain, float release, int sampleRate)
+        : env_(attack, decay, sustain, release, sampleRate), sampleRate_(sampleRate) {
+        env_.note_on();
+    }
+
+    size_t process(double *block, size_t n) override {
+        env_.process(block, block, n);
+        return n;
+    }
+
+    double sampleRate() const override {
+        return sampleRate_;
+    }
+
+private:
+    ADSR env_;
+    int sampleRate_;
+};
+
+// The argument definitions mirror the standalone tools so a stage can be
+// pasted from a shell pipeline unchanged.
+unique_ptr<Node> parseCv(const vector<string> &args) {
+
+    argparse::ArgumentParser parser("cv");
+    parser.add_argument("--sampleRate").default_value(48000.0).help("sampling rate").scan<'g', double>();
+    parser.add_argument("--amplitude").default_value(1.0).help("amplitude").scan<'g', double>();
+    parser.add_argument("--duration").default_value(1.0).help("duration").scan<'g', double>();
+    parser.parse_args(args);
+
+    return make_unique<CvNode>(parser.get<double>("sampleRate"), parser.get<double>("amplitude"), parser.get<double>("duration"));
+}
+
+unique_ptr<Node> parseVco(const vector<string> &args) {
+
+    argparse::ArgumentParser parser("vco");
+    parser.add_argument("--sensitivity").default_value(1.0).help("control voltage sensitivity").scan<'g', double>();
+    parser.add_argument("--sample_rate").default_value(48000.0).help("sampling rate").scan<'g', double>();
+    parser.add_argument("--amplitude").default_value(1.0).help("amplitude").scan<'g', double>();
+    parser.add_argument("--wave_type").default_value(string("sine")).help("sine, triangle, square");
+    parser.add_argument("--engine").default_value(string("naive")).help("naive, wavetable, polyblep");
+    parser.add_argument("--precision").default_value(string("full")).help("low, high, full");
+    parser.parse_args(args);
+
+    return make_unique<VcoNode>(parser.get<double>("sample_rate"), parser.get<double>("sensitivity"),
+        parser.get<double>("amplitude"), parseWaveType(parser.get<string>("wave_type")), parseEngine(parser.get<string>("engine")),
+        parsePrecision(parser.get<string>("precision")));
+}
+
+unique_ptr<Node> parseFilter(const vector<string> &args) {
+
+    argparse::ArgumentParser parser("filter");
+    parser.add_argument("--filter_type").default_value(string("lowpass")).help("lowpass | highpass");
+    parser.add_argument("--cutoff").required().help("cutoff frequency in Hz").scan<'g', double>();
+    parser.add_argument("--rolloff").default_value(12).help("rolloff in dB/oct (multiple of 6)").scan<'i', int>();
+    parser.add_argument("--sample_rate").default_value(48000.0).help("sampling rate (Hz)").scan<'g', double>();
+    parser.add_argument("--precision").default_value(string("full")).help("low | high | full");
+    parser.parse_args(args);
+
+    int rolloff_db= parser.get<int>("rolloff");
+    if (rolloff_db % 6 != 0)
+        throw runtime_error("rolloff must be an integer multiple of 6 dB");
+
+    return make_unique<FilterNode>(parser.get<double>("sample_rate"), parseFilterType(parser.get<string>("filter_type")),
+        parser.get<double>("cutoff"), rolloff_db, parsePrecision(parser.get<string>("precision")));
+}
+
+unique_ptr<Node> parseEnv(const vector<string> &args) {
+
+    argparse::ArgumentParser parser("env");
+    parser.add_argument("--attack").default_value(0.01f).help("attack").scan<'g', float>();
+    parser.add_argument("--decay").default_value(0.1f).help("decay").scan<'g', float>();
+    parser.add_argument("--sustain").default_value(0.7f).help("sustain").scan<'g', float>();
+    parser.add_argument("--release").default_value(0.3f).help("release").scan<'g', float>();
+    parser.add_argument("--sample_rate").default_value(48000).help("sample_rate").scan<'i', int>();
+    parser.parse_args(args);
+
+    return make_unique<EnvNode>(parser.get<float>("attack"), parser.get<float>("decay"), parser.get<float>("sustain"),
+        parser.get<float>("release"), parser.get<int>("sample_rate"));
+}
+
+vector<string> tokenize(const string &stage) {
+
+    istringstream iss(stage);
+    vector<string> tokens;
+    string token;
+
+    while (iss >> token)
+        tokens.push_back(token);
+
+    return tokens;
+}
+
+} // namespace
+
+unique_ptr<Node> makeNode(const vector<string> &args) {
+
+    if (args.empty())
+        throw runtime_error("empty patch stage");
+
+    const string &module= args.front();
+
+    try {
+        if (module == "cv")
+            return parseCv(args);
+        if (module == "vco")
+            return parseVco(args);
+        if (module == "filter")
+            return parseFilter(args);
+        if (module == "env")
+            return parseEnv(args);
+    } catch (const exception &err) {
+        throw runtime_error(module + ": " + err.what());
+    }
+
+    throw runtime_error("unknown module '" + module + "' (expected cv, vco, filter or env)");
+}
+
+Patch::Patch(const string &chain) {
+
+    istringstream iss(chain);
+    string stage;
+
+    while (getline(iss, stage, '|')) {
+        auto node= makeNode(tokenize(stage));
+
+        if (node->isSource() && !nodes_.empty())
+            throw runtime_error("a source module can only start a patch");
+
+        nodes_.push_back(move(node));
+    }
+
+    if (nodes_.empty())
+        throw runtime_error("empty patch");
+}
+
+Patch Patch::load(const string &path) {
+
+    ifstream file(path);
+    if (!file)
+        throw runtime_error("cannot open patch file: " + path);
+
+    string line;
+    string chain;
+
+    while (getline(file, line)) {
+        line= line.substr(0, line.find('#'));
+        if (tokenize(line).empty())
+            continue;
+
+        if (!chain.empty())
+            chain+= '|';
+        chain+= line;
+    }
+
+    return Patch(chain);
+}
+
+size_t Patch::process(double *block, size_t n) {
+
+    for (auto &node : nodes_) {
+        n= node->process(block, n);
+        if (n == 0)
+            break;
+    }
+
+    return n;
+}
+
+Graph::Graph(vector<Patch> branches, optional<Patch> mix, size_t threads)
+    : branches_(move(branches)), mix_(move(mix)), scheduler_(threads),
+    buffers_(branches_.size()), produced_(branches_.size())
+{
+    if (branches_.empty())
+        throw runtime_error("a graph needs at least one branch");
+
+    for (const auto &branch : branches_)
+        if (branch.hasSource() != hasSource())
+            throw runtime_error("branches must either all start with a source or all process stdin");
+
+    if (mix_ && mix_->hasSource())
+        throw runtime_error("the mix chain cannot start with a source");
+}
+
+size_t Graph::process(double *block, size_t n)
+{
+    bool source= hasSource();
+
+    scheduler_.run(branches_.size(), [&](size_t b) {
+        vector<double> &buffer= buffers_[b];
+        buffer.resize(n);
+
+        if (!source)
+            copy(block, block + n, buffer.begin());
+
+        produced_[b]= branches_[b].process(buffer.data(), n);
+    });
+
+    size_t length= *max_element(produced_.begin(), produced_.end());
+
+    // the first branch is copied, so a single branch passes through untouched
+    copy(buffers_[0].begin(), buffers_[0].begin() + produced_[0], block);
+    fill(block + produced_[0], block + length, 0.0);
+
+    for (size_t b= 1; b < branches_.size(); ++b)
+        for (size_t i= 0; i < produced_[b]; ++i)
+            block[i]+= buffers_[b][i];
+
+    if (mix_ && length > 0)
+        length= mix_->process(block, length);
+
+    return length;
+}
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "env.hpp"
+#include "poly.hpp"
+
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define POLY_X86 1
+#endif
+
+namespace {
+
+// Kernel width; voices are padded to a multiple of it. Each target below
+// compiles the same W lanes into its own register width.
+constexpr size_t W= 8;
+
+typedef double vecd __attribute__((vector_size(W * sizeof(double))));
+typedef long long maskd __attribute__((vector_size(W * sizeof(double))));
+typedef float vecf __attribute__((vector_size(W * sizeof(float))));
+typedef int32_t veci __attribute__((vector_size(W * sizeof(int32_t))));
+
+struct Envelope {
+    float attack, decay, sustain, release;
+};
+
+// sin(2 pi phase) for phase in [0, 1): fold into [-1/4, 1/4] and evaluate
+// the Taylor series to x^15 (error below 1e-11)
+[[gnu::always_inline]] inline void sineLanes(const vecd &phase, vecd &y)
+{
+    vecd t= phase >= 0.5 ? phase - 1.0 : phase;
+    t= t > 0.25 ? 0.5 - t : t;
+    t= t < -0.25 ? -0.5 - t : t;
+
+    vecd x= 2.0 * M_PI * t;
+    vecd x2= x * x;
+    vecd s= 1.0 - x2 * (1.0 / 210.0);
+    s= 1.0 - x2 * (1.0 / 156.0) * s;
+    s= 1.0 - x2 * (1.0 / 110.0) * s;
+    s= 1.0 - x2 * (1.0 / 72.0) * s;
+    s= 1.0 - x2 * (1.0 / 42.0) * s;
+    s= 1.0 - x2 * (1.0 / 20.0) * s;
+    s= 1.0 - x2 * (1.0 / 6.0) * s;
+    y= x * s;
+}
+
+// One sample for every voice. The envelope follows ADSR::update() lane by
+// lane, with each branch turned into a select.
+[[gnu::always_inline]] inline void stepVoices(size_t padded, Vco::WaveType waveType, const Envelope &env,
+    double *phases, const double *increments, int32_t *stages, int32_t *counters, float *levels,
+    double *wave, float *envelope)
+{
+    const veci attack= veci{} + static_cast<int32_t>(Stage::Attack);
+    const veci decay= veci{} + static_cast<int32_t>(Stage::Decay);
+    const veci sustain= veci{} + static_cast<int32_t>(Stage::Sustain);
+    const veci release= veci{} + static_cast<int32_t>(Stage::Release);
+    const veci idle= veci{} + static_cast<int32_t>(Stage::Idle);
+
+    for (size_t v= 0; v < padded; v+= W) {
+        vecd phase, increment, y;
+        veci stage, counter;
+        vecf level;
+
+        memcpy(&phase, phases + v, sizeof(phase));
+        memcpy(&increment, increments + v, sizeof(increment));
+        memcpy(&stage, stages + v, sizeof(stage));
+        memcpy(&counter, counters + v, sizeof(counter));
+
+        phase+= increment;
+        phase= phase >= 1.0 ? phase - 1.0 : phase;
+        phase= phase < 0.0 ? phase + 1.0 : phase;
+
+        switch (waveType) {
+            case Vco::WaveType::TRIANGLE: {
+                vecd d= phase - 0.5;
+                y= 4.0 * (d < 0.0 ? -d : d) - 1.0;
+                break;
+            }
+            case Vco::WaveType::SQUARE:
+                y= phase < 0.5 ? vecd{} + 1.0 : vecd{} - 1.0;
+                break;
+            default:
+                sineLanes(phase, y);
+                break;
+        }
+
+        vecf count= __builtin_convertvector(counter, vecf);
+        vecf next= __builtin_convertvector(counter + 1, vecf);
+        vecf one= vecf{} + 1.0f;
+
+        // attack
+        vecf ramp= count / env.attack;
+        veci attackDone= next >= env.attack;
+        vecf attackLevel= attackDone ? one : (ramp < 1.0f ? ramp : one);
+
+        // decay; a zero decay leaves the counter alone, which sustain ignores
+        vecf progress= count / env.decay;
+        progress= progress < 1.0f ? progress : one;
+        veci decayDone= next >= env.decay;
+        vecf decayLevel= decayDone ? vecf{} + env.sustain : 1.0f - (1.0f - env.sustain) * progress;
+
+        // release
+        progress= count / env.release;
+        progress= progress < 1.0f ? progress : one;
+        vecf fading= env.sustain * (1.0f - progress);
+        veci releaseDone= (next >= env.release) | (fading <= 0.001f);
+        vecf releaseLevel= releaseDone ? vecf{} : fading;
+
+        veci isAttack= stage == attack;
+        veci isDecay= stage == decay;
+        veci isSustain= stage == sustain;
+        veci isRelease= stage == release;
+
+        level= isAttack ? attackLevel
+            : isDecay ? decayLevel
+            : isSustain ? vecf{} + env.sustain
+            : isRelease ? releaseLevel
+            : vecf{};
+
+        veci nextStage= isAttack ? (attackDone ? decay : attack)
+            : isDecay ? (decayDone ? sustain : decay)
+            : isRelease ? (releaseDone ? idle : release)
+            : stage;
+        veci counting= isAttack | isDecay | isRelease;
+        counter= isAttack & attackDone ? veci{} : (counting ? counter + 1 : counter);
+        stage= nextStage;
+
+        memcpy(phases + v, &phase, sizeof(phase));
+        memcpy(stages + v, &stage, sizeof(stage));
+        memcpy(counters + v, &counter, sizeof(counter));
+        memcpy(levels + v, &level, sizeof(level));
+        memcpy(wave + v, &y, sizeof(y));
+        memcpy(envelope + v, &level, sizeof(level));
+    }
+}
+
+// Sums wave * envelope over the voices of each frame, W partial sums per
+// frame so the adds do not serialize on one accumulator.
+void mixVoices(const double *wave, const float *envelope, size_t padded, double amplitude, double *out, size_t frames)
+{
+    for (size_t t= 0; t < frames; ++t) {
+        vecd sum{};
+
+        for (size_t v= 0; v < padded; v+= W) {
+            vecd y;
+            vecf level;
+            memcpy(&y, wave + t * padded + v, sizeof(y));
+            memcpy(&level, envelope + t * padded + v, sizeof(level));
+            sum+= y * __builtin_convertvector(level, vecd);
+        }
+
+        double total= 0.0;
+        for (size_t k= 0; k < W; ++k)
+            total+= sum[k];
+
+        out[t]= amplitude * total;
+    }
+}
+
+typedef void (*StepFunction)(size_t, Vco::WaveType, const Envelope &, double *, const double *, int32_t *, int32_t *,
+    float *, double *, float *);
+
+void stepGeneric(size_t padded, Vco::WaveType waveType, const Envelope &env, double *phases, const double *increments,
+    int32_t *stages, int32_t *counters, float *levels, double *wave, float *envelope)
+{
+    stepVoices(padded, waveType, env, phases, increments, stages, counters, levels, wave, envelope);
+}
+
+#ifdef POLY_X86
+__attribute__((target("avx2")))
+void stepAvx2(size_t padded, Vco::WaveType waveType, const Envelope &env, double *phases, const double *increments,
+    int32_t *stages, int32_t *counters, float *levels, double *wave, float *envelope)
+{
+    stepVoices(padded, waveType, env, phases, increments, stages, counters, levels, wave, envelope);
+}
+
+__attribute__((target("avx512f")))
+void stepAvx512(size_t padded, Vco::WaveType waveType, const Envelope &env, double *phases, const double *increments,
+    int32_t *stages, int32_t *counters, float *levels, double *wave, float *envelope)
+{
+    stepVoices(padded, waveType, env, phases, increments, stages, counters, levels, wave, envelope);
+}
+#endif
+
+StepFunction selectStep(SimdLevel level)
+{
+    switch (level) {
+#ifdef POLY_X86
+        case SimdLevel::AVX2:
+            return stepAvx2;
+        case SimdLevel::AVX512:
+            return stepAvx512;
+#endif
+        default:
+            return stepGeneric;
+    }
+}
+
+} // namespace
+
+Poly::Poly(double sampleRate, size_t voices, double sensitivity, double amplitude, Vco::WaveType waveType,
+    float attack, float decay, float sustain, float release, SimdLevel simd)
+    : sampleRate_(sampleRate), voices_(voices), padded_((voices + W - 1) / W * W),
+    sensitivity_(sensitivity), amplitude_(amplitude), waveType_(waveType),
+    attack_(attack * sampleRate), decay_(decay * sampleRate), sustain_(sustain), release_(release * sampleRate),
+    simd_(simd), clock_(0),
+    phase_(padded_), increment_(padded_), stage_(padded_, static_cast<int32_t>(Stage::Idle)),
+    counter_(padded_), level_(padded_),
+    owner_(voices, -1), started_(voices) {
+
+    if (voices_ == 0)
+        throw runtime_error("voices must be at least 1");
+}
+
+void Poly::setFilter(const vector<Biquad> &sections) {
+
+    filter_= make_unique<BiquadBank>(sections, padded_, simd_);
+}
+
+size_t Poly::allocate() {
+
+    size_t best= 0;
+
+    for (size_t v= 0; v < voices_; ++v)
+        if (stage_[v] == static_cast<int32_t>(Stage::Idle))
+            return v;
+
+    // steal: the quietest releasing voice, else the oldest note
+    bool releasing= false;
+
+    for (size_t v= 0; v < voices_; ++v) {
+        if (stage_[v] == static_cast<int32_t>(Stage::Release)) {
+            if (!releasing || level_[v] < level_[best])
+                best= v;
+            releasing= true;
+        } else if (!releasing && started_[v] < started_[best]) {
+            best= v;
+        }
+    }
+
+    return best;
+}
+
+double Poly::increment(double controlVoltage) const {
+
+    double frequency= sensitivity_ * controlVoltage;
+
+    // as Vco::generateTriangleWave() and generateSquareWave(); the sine's
+    // radians are turns here
+    if (waveType_ == Vco::WaveType::TRIANGLE)
+        return (2.0 * frequency) / sampleRate_;
+
+    return frequency / sampleRate_;
+}
+
+void Poly::noteOn(size_t lane, double controlVoltage) {
+
+    if (lane >= voice_.size()) {
+        voice_.resize(lane + 1, -1);
+        gates_.resize(lane + 1, false);
+        cv_.resize(lane + 1, 0.0);
+    }
+
+    // a retrigger keeps the lane's voice
+    long v= voice_[lane];
+    if (v < 0) {
+        v= allocate();
+
+        if (owner_[v] >= 0)
+            voice_[owner_[v]]= -1;
+
+        owner_[v]= lane;
+        voice_[lane]= v;
+        phase_[v]= 0.0;
+
+        // the new note must not ring through the previous one's filter
+        if (filter_)
+            filter_->reset(v);
+    }
+
+    cv_[lane]= controlVoltage;
+    increment_[v]= increment(controlVoltage);
+    stage_[v]= static_cast<int32_t>(Stage::Attack);
+    counter_[v]= 0;
+    started_[v]= clock_++;
+}
+
+void Poly::noteOff(size_t lane) {
+
+    if (lane >= voice_.size() || voice_[lane] < 0)
+        return;
+
+    long v= voice_[lane];
+    if (stage_[v] != static_cast<int32_t>(Stage::Idle)) {
+        stage_[v]= static_cast<int32_t>(Stage::Release);
+        counter_[v]= 0;
+    }
+}
+
+size_t Poly::active() const {
+
+    return count_if(stage_.begin(), stage_.begin() + voices_,
+        [](int32_t stage) { return stage != static_cast<int32_t>(Stage::Idle); });
+}
+
+void Poly::process(const double *lanes, size_t laneCount, double *out, size_t frames) {
+
+    if (voice_.size() < laneCount) {
+        voice_.resize(laneCount, -1);
+        gates_.resize(laneCount, false);
+        cv_.resize(laneCount, 0.0);
+    }
+
+    wave_.resize(frames * padded_);
+    envelope_.resize(frames * padded_);
+
+    StepFunction step= selectStep(simd_);
+    Envelope env {attack_, decay_, sustain_, release_};
+    // frames before this one have been through the filter
+    size_t filtered= 0;
+
+    for (size_t t= 0; t < frames; ++t) {
+        const double *frame= lanes + t * laneCount * 2;
+
+        // gate edges (> 0.5, as in ADSR::process) and cv changes, per lane
+        for (size_t k= 0; k < laneCount; ++k) {
+            double cv= frame[2 * k];
+            bool high= (static_cast<float>(frame[2 * k + 1]) > 0.5f);
+
+            if (high && !gates_[k]) {
+                // a voice about to be claimed filters its earlier frames
+                // with the old state before noteOn() clears it
+                if (filter_ && voice_[k] < 0 && t > filtered) {
+                    double *pending= wave_.data() + filtered * padded_;
+                    filter_->process(pending, pending, t - filtered);
+                    filtered= t;
+                }
+                noteOn(k, cv);
+            } else {
+                if (!high && gates_[k])
+                    noteOff(k);
+
+                if (cv != cv_[k]) {
+                    cv_[k]= cv;
+                    if (voice_[k] >= 0)
+                        increment_[voice_[k]]= increment(cv);
+                }
+            }
+
+            gates_[k]= high;
+        }
+
+        step(padded_, waveType_, env, phase_.data(), increment_.data(), stage_.data(), counter_.data(),
+            level_.data(), wave_.data() + t * padded_, envelope_.data() + t * padded_);
+    }
+
+    if (filter_ && frames > filtered) {
+        double *pending= wave_.data() + filtered * padded_;
+        filter_->process(pending, pending, frames - filtered);
+    }
+
+    mixVoices(wave_.data(), envelope_.data(), padded_, amplitude_, out, frames);
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "rasterizer.hpp"
+
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RASTER_X86 1
+#endif
+
+namespace {
+
+template<int W> struct Lanes {
+    typedef int32_t vec __attribute__((vector_size(W * sizeof(int32_t))));
+};
+
+// Lays color over the columns of row whose span [top, bottom] holds y,
+// W columns at a time.
+template<int W>
+[[gnu::always_inline]] inline void blendSpans(const int32_t *top, const int32_t *bottom, uint32_t color, int y, uint32_t *row, size_t width)
+{
+    using vec= typename Lanes<W>::vec;
+
+    const vec rowY= vec{} + y;
+    const vec fill= vec{} + static_cast<int32_t>(color);
+    size_t whole= width / W * W;
+
+    for (size_t x= 0; x < whole; x+= W) {
+        vec t, b, pixels;
+        memcpy(&t, top + x, sizeof(t));
+        memcpy(&b, bottom + x, sizeof(b));
+        memcpy(&pixels, row + x, sizeof(pixels));
+
+        pixels= (t <= rowY && rowY <= b) ? fill : pixels;
+        memcpy(row + x, &pixels, sizeof(pixels));
+    }
+
+    for (size_t x= whole; x < width; ++x) {
+        if (top[x] <= y && y <= bottom[x])
+            row[x]= color;
+    }
+}
+
+void blendGeneric(const int32_t *top, const int32_t *bottom, uint32_t color, int y, uint32_t *row, size_t width)
+{
+    blendSpans<4>(top, bottom, color, y, row, width);
+}
+
+#ifdef RASTER_X86
+__attribute__((target("avx2")))
+void blendAvx2(const int32_t *top, const int32_t *bottom, uint32_t color, int y, uint32_t *row, size_t width)
+{
+    blendSpans<8>(top, bottom, color, y, row, width);
+}
+#endif
+
+Rasterizer::BlendFunction selectBlend(SimdLevel level)
+{
+    switch (level) {
+#ifdef RASTER_X86
+        // GCC 12 scalarises the 16-lane compare once it is inlined
+        // into an avx512f function, so AVX-512 machines take the AVX2 kernel
+        case SimdLevel::AVX2:
+        case SimdLevel::AVX512:
+            return blendAvx2;
+#endif
+        default:
+            return blendGeneric;
+    }
+}
+
+} // namespace
+
+Rasterizer::Rasterizer(int width, int height, SimdLevel simd)
+    : width_(width), height_(height), blend_(selectBlend(simd)), used_(0), previousUsed_(0)
+{
+}
+
+void Rasterizer::clear()
+{
+    swap(layers_, previous_);
+    previousUsed_= used_;
+    used_= 0;
+}
+
+Rasterizer::Layer &Rasterizer::nextLayer(uint32_t color)
+{
+    if (used_ == layers_.size()) {
+        layers_.emplace_back();
+        layers_.back().top.resize(width_);
+        layers_.back().bottom.resize(width_);
+    }
+
+    Layer &layer= layers_[used_++];
+    layer.first= INT32_MAX;
+    layer.last= INT32_MIN;
+    layer.area= 0;
+    layer.color= color;
+    return layer;
+}
+
+void Rasterizer::addTrace(const Envelope::Column *columns, float halfScale, uint32_t color, bool rms)
+{
+    float yCenter= height_ / 2.0f;
+    int yLimit= height_ - 1;
+
+    auto toY= [&](float v) {
+        return clamp(static_cast<int>(yCenter - (v / halfScale) * yCenter), 0, yLimit);
+    };
+
+    Layer &envelope= nextLayer(color);
+    for (int x= 0; x < width_; ++x) {
+        envelope.top[x]= toY(columns[x].max);
+        envelope.bottom[x]= toY(columns[x].min);
+        envelope.first= min(envelope.first, envelope.top[x]);
+        envelope.last= max(envelope.last, envelope.bottom[x]);
+        envelope.area+= envelope.bottom[x] - envelope.top[x] + 1;
+    }
+
+    if (!rms)
+        return;
+
+    // 0x00FF00 becomes 0xA0FFA0
+    Layer &band= nextLayer(color | 0xA0A0A0);
+    for (int x= 0; x < width_; ++x) {
+        band.top[x]= toY(columns[x].rms);
+        band.bottom[x]= toY(-columns[x].rms);
+        band.first= min(band.first, band.top[x]);
+        band.last= max(band.last, band.bottom[x]);
+        band.area+= band.bottom[x] - band.top[x] + 1;
+    }
+}
+
+void Rasterizer::drawRow(int y, uint32_t *row) const
+{
+    for (size_t i= 0; i < used_; ++i) {
+        const Layer &layer= layers_[i];
+        if (y >= layer.first && y <= layer.last)
+            blend_(layer.top.data(), layer.bottom.data(), layer.color, y, row, width_);
+    }
+}
+
+void Rasterizer::updateColumns(uint32_t *pixels, const uint32_t *const *background) const
+{
+    for (size_t i= 0; i < previousUsed_; ++i) {
+        const Layer &layer= previous_[i];
+        for (int x= 0; x < width_; ++x) {
+            for (int y= layer.top[x]; y <= layer.bottom[x]; ++y)
+                pixels[static_cast<size_t>(y) * width_ + x]= background[y][x];
+        }
+    }
+
+    for (size_t i= 0; i < used_; ++i) {
+        const Layer &layer= layers_[i];
+        for (int x= 0; x < width_; ++x) {
+            for (int y= layer.top[x]; y <= layer.bottom[x]; ++y)
+                pixels[static_cast<size_t>(y) * width_ + x]= layer.color;
+        }
+    }
+}
+
+int Rasterizer::firstRow() const
+{
+    int first= height_;
+    for (size_t i= 0; i < used_; ++i)
+        first= min(first, layers_[i].first);
+    for (size_t i= 0; i < previousUsed_; ++i)
+        first= min(first, previous_[i].first);
+    return first;
+}
+
+int Rasterizer::lastRow() const
+{
+    int last= -1;
+    for (size_t i= 0; i < used_; ++i)
+        last= max(last, layers_[i].last);
+    for (size_t i= 0; i < previousUsed_; ++i)
+        last= max(last, previous_[i].last);
+    return last;
+}
+
+size_t Rasterizer::coverage() const
+{
+    size_t area= 0;
+    for (size_t i= 0; i < used_; ++i)
+        area+= layers_[i].area;
+    for (size_t i= 0; i < previousUsed_; ++i)
+        area+= previous_[i].area;
+    return area;
+}
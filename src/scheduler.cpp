@@ -0,0 +1,154 @@
+#include <stdexcept>
+
+#include "scheduler.hpp"
+
+using namespace std;
+
+// spins before a worker sleeps on the condition variable
+static const int spinLimit= 4096;
+
+size_t parseThreads(int threads)
+{
+    if (threads < 0)
+        throw runtime_error("threads must be 0 (all cores) or a positive count");
+
+    if (threads == 0)
+        return max(1u, thread::hardware_concurrency());
+
+    return threads;
+}
+
+Scheduler::Scheduler(size_t threads)
+    : task_(nullptr), pending_(0), generation_(0), stop_(false)
+{
+    if (threads == 0)
+        threads= max(1u, thread::hardware_concurrency());
+
+    for (size_t i= 0; i < threads; ++i)
+        queues_.push_back(make_unique<Queue>());
+
+    // queue 0 belongs to the thread calling run()
+    for (size_t i= 1; i < threads; ++i)
+        threads_.emplace_back(&Scheduler::work, this, i);
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        lock_guard<mutex> guard(lock_);
+        stop_= true;
+        generation_.fetch_add(1, memory_order_release);
+    }
+    wake_.notify_all();
+
+    for (auto &t : threads_)
+        t.join();
+}
+
+bool Scheduler::runOne(size_t self)
+{
+    size_t index= 0;
+    bool found= false;
+
+    for (size_t i= 0; i < queues_.size() && !found; ++i) {
+        Queue &queue= *queues_[(self + i) % queues_.size()];
+        lock_guard<mutex> guard(queue.lock);
+
+        if (queue.tasks.empty())
+            continue;
+
+        // own work from the front, stolen work from the back
+        if (i == 0) {
+            index= queue.tasks.front();
+            queue.tasks.pop_front();
+        } else {
+            index= queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        found= true;
+    }
+
+    if (!found)
+        return false;
+
+    try {
+        (*task_)(index);
+    } catch (...) {
+        lock_guard<mutex> guard(errorLock_);
+        if (!error_)
+            error_= current_exception();
+    }
+
+    pending_.fetch_sub(1, memory_order_acq_rel);
+    return true;
+}
+
+void Scheduler::work(size_t self)
+{
+    uint64_t seen= 0;
+
+    while (true) {
+        uint64_t generation= generation_.load(memory_order_acquire);
+
+        for (int spin= 0; generation == seen && spin < spinLimit; ++spin) {
+            this_thread::yield();
+            generation= generation_.load(memory_order_acquire);
+        }
+
+        if (generation == seen) {
+            unique_lock<mutex> guard(lock_);
+            wake_.wait(guard, [&] { return generation_.load(memory_order_acquire) != seen; });
+            generation= generation_.load(memory_order_acquire);
+        }
+
+        seen= generation;
+
+        {
+            lock_guard<mutex> guard(lock_);
+            if (stop_)
+                return;
+        }
+
+        while (runOne(self))
+            ;
+    }
+}
+
+void Scheduler::run(size_t count, const function<void(size_t)> &task)
+{
+    if (count == 0)
+        return;
+
+    // nothing to share: skip the queues entirely
+    if (threads_.empty() || count == 1) {
+        for (size_t i= 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    task_= &task;
+    error_= nullptr;
+    pending_.store(count, memory_order_relaxed);
+
+    for (size_t i= 0; i < count; ++i) {
+        Queue &queue= *queues_[i % queues_.size()];
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(i);
+    }
+
+    {
+        lock_guard<mutex> guard(lock_);
+        generation_.fetch_add(1, memory_order_release);
+    }
+    wake_.notify_all();
+
+    while (runOne(0))
+        ;
+
+    // join: the remaining tasks are already running on other threads
+    while (pending_.load(memory_order_acquire) != 0)
+        this_thread::yield();
+
+    if (error_)
+        rethrow_exception(error_);
+}
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "shmring.hpp"
+
+using namespace std;
+
+static constexpr uint32_t shmMagic= 0x534d4c43;     // "CLMS" little-endian
+static constexpr uint32_t shmVersion= 1;
+
+static_assert(atomic<uint64_t>::is_always_lock_free, "the shared ring needs lock-free 64-bit atomics");
+
+// Lives at the start of the mapping, followed by the sample data. A zero
+// page is a valid "not initialised yet" state for every field.
+struct ShmRing::Shared {
+    atomic<uint32_t> magic;             // set last by the creator
+    uint32_t version;
+    uint64_t capacity;
+
+    atomic<uint32_t> producerReady;     // channels/sampleRate are valid
+    uint32_t channels;
+    double sampleRate;
+
+    // producer's cache line
+    alignas(64) atomic<uint64_t> head;
+    atomic<uint32_t> dataSeq;           // futex word: bumped on every commit
+    atomic<uint32_t> consumerWaiting;
+    atomic<uint32_t> closed;
+
+    // consumer's cache line
+    alignas(64) atomic<uint64_t> tail;
+    atomic<uint32_t> spaceSeq;          // futex word: bumped on every release
+    atomic<uint32_t> producerWaiting;
+};
+
+namespace {
+
+#ifdef __linux__
+// Process-shared futex; the timeout makes a sleeper recheck the ring now
+// and then, so a peer that died mid-handshake cannot hang it forever.
+void futexWait(atomic<uint32_t> &word, uint32_t expected) {
+    timespec timeout{0, 100 * 1000 * 1000};
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void futexWake(atomic<uint32_t> &word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+// bump the sequence word and wake the other side if it sleeps on it
+void signal(atomic<uint32_t> &seq, atomic<uint32_t> &waiting) {
+    seq.fetch_add(1, memory_order_seq_cst);
+#ifdef __linux__
+    if (waiting.load(memory_order_seq_cst))
+        futexWake(seq);
+#else
+    (void) waiting;
+#endif
+}
+
+} // namespace
+
+size_t ShmRing::headerBytes()
+{
+    return (sizeof(Shared) + 63) / 64 * 64;
+}
+
+ShmRing::ShmRing(const string &name, Role role, double sampleRate, uint32_t channels)
+    : shared_(nullptr), data_(nullptr), capacity_(defaultCapacity),
+    bytes_(headerBytes() + defaultCapacity * sizeof(double)), fd_(-1), role_(role),
+    path_("/clmodular-" + name), closed_(false)
+{
+#ifndef __linux__
+    throw runtime_error("shared memory transport needs Linux futexes");
+#endif
+
+    if (name.empty() || name.find('/') != string::npos)
+        throw runtime_error("invalid shm name '" + name + "'");
+
+    bool creator= true;
+    fd_= shm_open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd_ < 0 && errno == EEXIST) {
+        creator= false;
+        fd_= shm_open(path_.c_str(), O_RDWR, 0600);
+    }
+
+    if (fd_ < 0)
+        throw runtime_error("shm_open " + path_ + ": " + strerror(errno));
+
+    if (creator) {
+        if (ftruncate(fd_, bytes_) < 0) {
+            int err= errno;
+            ::close(fd_);
+            shm_unlink(path_.c_str());
+            throw runtime_error("sizing " + path_ + ": " + strerror(err));
+        }
+    } else {
+        // the creator may still be sizing the object
+        struct stat st;
+        while (fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) < bytes_)
+            this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    void *map= mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        int err= errno;
+        ::close(fd_);
+        throw runtime_error("mmap " + path_ + ": " + strerror(err));
+    }
+
+    shared_= static_cast<Shared *>(map);
+    data_= reinterpret_cast<double *>(static_cast<char *>(map) + headerBytes());
+
+    if (creator) {
+        shared_->version= shmVersion;
+        shared_->capacity= capacity_;
+        shared_->magic.store(shmMagic, memory_order_release);
+    } else {
+        while (shared_->magic.load(memory_order_acquire) != shmMagic)
+            this_thread::sleep_for(chrono::milliseconds(1));
+
+        if (shared_->version != shmVersion || shared_->capacity != capacity_) {
+            munmap(map, bytes_);
+            ::close(fd_);
+            throw runtime_error(path_ + " has an incompatible layout");
+        }
+
+        // left behind by a producer whose consumer never ran
+        if (role_ == Role::PRODUCER && shared_->producerReady.load(memory_order_acquire)) {
+            munmap(map, bytes_);
+            ::close(fd_);
+            throw runtime_error(path_ + " is already in use (remove it if stale)");
+        }
+    }
+
+    if (role_ == Role::PRODUCER) {
+        shared_->channels= channels;
+        shared_->sampleRate= sampleRate;
+        shared_->producerReady.store(1, memory_order_release);
+        signal(shared_->dataSeq, shared_->consumerWaiting);
+    }
+}
+
+ShmRing::~ShmRing()
+{
+    if (role_ == Role::PRODUCER)
+        close();
+    else
+        shm_unlink(path_.c_str());
+
+    munmap(shared_, bytes_);
+    ::close(fd_);
+}
+
+void ShmRing::close()
+{
+    if (closed_)
+        return;
+
+    closed_= true;
+    shared_->closed.store(1, memory_order_release);
+    shared_->dataSeq.fetch_add(1, memory_order_seq_cst);
+#ifdef __linux__
+    futexWake(shared_->dataSeq);
+#endif
+}
+
+pair<span<double>, span<double>> ShmRing::writeSpans()
+{
+    uint64_t head= shared_->head.load(memory_order_relaxed);
+    uint64_t tail= shared_->tail.load(memory_order_acquire);
+    size_t start= head & (capacity_ - 1);
+    size_t free= capacity_ - (head - tail);
+    size_t split= min(free, capacity_ - start);
+
+    return { span<double>(data_ + start, split), span<double>(data_, free - split) };
+}
+
+void ShmRing::commitWrite(size_t count)
+{
+    shared_->head.store(shared_->head.load(memory_order_relaxed) + count, memory_order_release);
+    signal(shared_->dataSeq, shared_->consumerWaiting);
+}
+
+pair<span<const double>, span<const double>> ShmRing::readSpans()
+{
+    uint64_t tail= shared_->tail.load(memory_order_relaxed);
+    uint64_t head= shared_->head.load(memory_order_acquire);
+    size_t start= tail & (capacity_ - 1);
+    size_t available= head - tail;
+    size_t split= min(available, capacity_ - start);
+
+    return { span<const double>(data_ + start, split), span<const double>(data_, available - split) };
+}
+
+void ShmRing::commitRead(size_t count)
+{
+    shared_->tail.store(shared_->tail.load(memory_order_relaxed) + count, memory_order_release);
+    signal(shared_->spaceSeq, shared_->producerWaiting);
+}
+
+void ShmRing::write(const double *src, size_t count)
+{
+    while (count > 0) {
+        uint32_t seq= shared_->spaceSeq.load(memory_order_acquire);
+        auto [first, second]= writeSpans();
+        size_t n= min(count, first.size() + second.size());
+
+        if (n == 0) {
+#ifdef __linux__
+            shared_->producerWaiting.store(1, memory_order_seq_cst);
+            if (shared_->head.load(memory_order_relaxed) - shared_->tail.load(memory_order_seq_cst) == capacity_)
+                futexWait(shared_->spaceSeq, seq);
+            shared_->producerWaiting.store(0, memory_order_relaxed);
+#endif
+            continue;
+        }
+
+        size_t split= min(n, first.size());
+        copy(src, src + split, first.begin());
+        copy(src + split, src + n, second.begin());
+        commitWrite(n);
+
+        src+= n;
+        count-= n;
+    }
+}
+
+size_t ShmRing::read(double *dest, size_t count, bool wait)
+{
+    if (!wait && !shared_->producerReady.load(memory_order_acquire))
+        return 0;
+
+    uint32_t channels= this->channels();
+
+    while (true) {
+        uint32_t seq= shared_->dataSeq.load(memory_order_acquire);
+        bool closed= shared_->closed.load(memory_order_acquire);
+        auto [first, second]= readSpans();
+        size_t n= min(count, first.size() + second.size());
+
+        // only whole frames, like the binary stream decoder
+        if (channels > 1)
+            n-= n % channels;
+
+        if (n > 0) {
+            size_t split= min(n, first.size());
+            copy(first.begin(), first.begin() + split, dest);
+            copy(second.begin(), second.begin() + (n - split), dest + split);
+            commitRead(n);
+            return n;
+        }
+
+        if (closed || !wait)
+            return 0;
+
+#ifdef __linux__
+        shared_->consumerWaiting.store(1, memory_order_seq_cst);
+        if (shared_->head.load(memory_order_seq_cst) - shared_->tail.load(memory_order_relaxed) < max<uint32_t>(channels, 1)
+            && !shared_->closed.load(memory_order_seq_cst))
+            futexWait(shared_->dataSeq, seq);
+        shared_->consumerWaiting.store(0, memory_order_relaxed);
+#endif
+    }
+}
+
+bool ShmRing::finished() const
+{
+    return shared_->closed.load(memory_order_acquire)
+        && shared_->head.load(memory_order_acquire) == shared_->tail.load(memory_order_relaxed);
+}
+
+void ShmRing::waitForProducer()
+{
+    while (!shared_->producerReady.load(memory_order_acquire)) {
+        uint32_t seq= shared_->dataSeq.load(memory_order_acquire);
+#ifdef __linux__
+        shared_->consumerWaiting.store(1, memory_order_seq_cst);
+        if (!shared_->producerReady.load(memory_order_seq_cst))
+            futexWait(shared_->dataSeq, seq);
+        shared_->consumerWaiting.store(0, memory_order_relaxed);
+#else
+        (void) seq;
+#endif
+    }
+}
+
+uint32_t ShmRing::channels()
+{
+    waitForProducer();
+    return shared_->channels > 0 ? shared_->channels : 1;
+}
+
+double ShmRing::sampleRate()
+{
+    waitForProducer();
+    return shared_->sampleRate;
+}
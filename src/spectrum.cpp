@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "spectrum.hpp"
+
+using namespace std;
+
+// levels of empty bins are clamped here rather than going to -inf
+static constexpr float floorDecibels= -300.0f;
+
+Spectrum::Spectrum(size_t size, Window window, Averaging averaging, float smoothing)
+    : fft_(size), averaging_(averaging), smoothing_(clamp(smoothing, 0.0f, 1.0f)), window_(size),
+    windowed_(size), re_(fft_.bins()), im_(fft_.bins()), power_(fft_.bins()),
+    decibels_(fft_.bins(), floorDecibels), empty_(true)
+{
+    // periodic windows, the usual choice for spectral analysis
+    for (size_t n= 0; n < size; ++n) {
+        double x= 2.0 * M_PI * n / size;
+
+        switch (window) {
+            case Window::RECTANGULAR:
+                window_[n]= 1.0;
+                break;
+            case Window::HANN:
+                window_[n]= 0.5 - 0.5 * cos(x);
+                break;
+            case Window::HAMMING:
+                window_[n]= 0.54 - 0.46 * cos(x);
+                break;
+            case Window::BLACKMAN_HARRIS:
+                window_[n]= 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+                break;
+            case Window::FLAT_TOP:
+                window_[n]= 0.21557895 - 0.41663158 * cos(x) + 0.277263158 * cos(2 * x)
+                    - 0.083578947 * cos(3 * x) + 0.006947368 * cos(4 * x);
+                break;
+        }
+    }
+
+    // a unit sine peaks at sum(w) / 2 in its bin
+    double gain= 0.0;
+    for (float w : window_)
+        gain+= w;
+    scale_= 4.0 / (gain * gain);
+}
+
+void Spectrum::reset()
+{
+    empty_= true;
+    fill(decibels_.begin(), decibels_.end(), floorDecibels);
+}
+
+void Spectrum::process(const float *frame)
+{
+    for (size_t n= 0; n < windowed_.size(); ++n)
+        windowed_[n]= frame[n] * window_[n];
+
+    fft_.forward(windowed_.data(), re_.data(), im_.data());
+
+    for (size_t k= 0; k < power_.size(); ++k) {
+        float power= (re_[k] * re_[k] + im_[k] * im_[k]) * scale_;
+
+        if (empty_ || averaging_ == Averaging::NONE)
+            power_[k]= power;
+        else if (averaging_ == Averaging::EXPONENTIAL)
+            power_[k]= smoothing_ * power_[k] + (1.0f - smoothing_) * power;
+        else
+            power_[k]= max(power_[k], power);
+
+        decibels_[k]= max(10.0f * log10(power_[k]), floorDecibels);
+    }
+
+    empty_= false;
+}
+
+Spectrum::Window parseWindow(const string &s)
+{
+    if (s == "rectangular")
+        return Spectrum::Window::RECTANGULAR;
+
+    if (s == "hann")
+        return Spectrum::Window::HANN;
+
+    if (s == "hamming")
+        return Spectrum::Window::HAMMING;
+
+    if (s == "blackman_harris")
+        return Spectrum::Window::BLACKMAN_HARRIS;
+
+    if (s == "flat_top")
+        return Spectrum::Window::FLAT_TOP;
+
+    throw runtime_error("window must be 'rectangular', 'hann', 'hamming', 'blackman_harris' or 'flat_top'");
+}
+
+Spectrum::Averaging parseAveraging(const string &s)
+{
+    if (s == "none")
+        return Spectrum::Averaging::NONE;
+
+    if (s == "exponential")
+        return Spectrum::Averaging::EXPONENTIAL;
+
+    if (s == "peak")
+        return Spectrum::Averaging::PEAK;
+
+    throw runtime_error("averaging must be 'none', 'exponential' or 'peak'");
+}
+
+void spectrumColumns(const float *decibels, size_t bins, double binWidth, double low, double high,
+    Envelope::Column *out, size_t width)
+{
+    double last= bins - 1;
+
+    // level at a fractional bin position
+    auto level= [&](double position) {
+        position= clamp(position, 0.0, last);
+        size_t k= min(static_cast<size_t>(position), bins - 2);
+        double t= position - k;
+        return static_cast<float>(decibels[k] + t * (decibels[k + 1] - decibels[k]));
+    };
+
+    double ratio= high / low;
+
+    for (size_t x= 0; x < width; ++x) {
+        double first= low * pow(ratio, static_cast<double>(x) / width) / binWidth;
+        double end= low * pow(ratio, static_cast<double>(x + 1) / width) / binWidth;
+
+        float a= level(first);
+        float b= level(end);
+        float lowest= min(a, b);
+        float highest= max(a, b);
+
+        for (size_t k= static_cast<size_t>(ceil(first)); k < end && k < bins; ++k) {
+            lowest= min(lowest, decibels[k]);
+            highest= max(highest, decibels[k]);
+        }
+
+        out[x]= { lowest, highest, 0.0f };
+    }
+}
@@ -0,0 +1,627 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stream.hpp"
+
+using namespace std;
+
+static constexpr char streamMagic[4]= { 'C', 'L', 'M', 'S' };
+static constexpr uint16_t streamVersion= 1;
+static constexpr size_t readBufferSize= 64 * 1024;
+// A writer holds at most this much before it flushes; it bounds the
+// latency each stage adds when nothing downstream forces a flush.
+static constexpr size_t flushSize= 8192;
+// Requested for every pipe a writer feeds (the unprivileged maximum).
+static constexpr int pipeSize= 1024 * 1024;
+
+Format parseFormat(const string &s)
+{
+    if (s == "text")
+        return Format::TEXT;
+
+    if (s == "raw")
+        return Format::RAW;
+
+    if (s == "f32")
+        return Format::F32;
+
+    if (s == "f64")
+        return Format::F64;
+
+    if (s == "ctl")
+        return Format::CTL;
+
+    throw runtime_error("format must be 'text', 'raw', 'f32', 'f64' or 'ctl'");
+}
+
+Format parseAudioFormat(const string &s)
+{
+    Format format= parseFormat(s);
+
+    if (format == Format::CTL)
+        throw runtime_error("format must be 'text', 'raw', 'f32' or 'f64' for audio; 'ctl' only carries control voltages");
+
+    return format;
+}
+
+ProcessingType parseProcessingType(const string &s)
+{
+    if (s == "double")
+        return ProcessingType::DOUBLE;
+
+    if (s == "float")
+        return ProcessingType::FLOAT;
+
+    throw runtime_error("sample_type must be 'double' or 'float'");
+}
+
+static unique_ptr<ShmRing> openShm(const string &name, ShmRing::Role role, double sampleRate, uint32_t channels)
+{
+    if (name.empty())
+        return nullptr;
+
+    try {
+        return make_unique<ShmRing>(name, role, sampleRate, channels);
+    } catch (const exception &e) {
+        cerr << "shm '" << name << "' unavailable (" << e.what() << "), falling back to "
+            << (role == ShmRing::Role::PRODUCER ? "stdout" : "stdin") << endl;
+        return nullptr;
+    }
+}
+
+// Enlarges the pipe behind fd, if fd is a pipe.
+static void tunePipe(int fd)
+{
+#ifdef F_SETPIPE_SZ
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode))
+        fcntl(fd, F_SETPIPE_SZ, pipeSize);
+#else
+    (void) fd;
+#endif
+}
+
+static size_t sampleSize(SampleType type)
+{
+    return (type == SampleType::FLOAT64) ? sizeof(double) : sizeof(float);
+}
+
+static SampleType sampleType(Format format)
+{
+    if (format == Format::F64)
+        return SampleType::FLOAT64;
+
+    return (format == Format::CTL) ? SampleType::CONTROL : SampleType::FLOAT32;
+}
+
+SampleReader::SampleReader(int fd, Format format, const string &shm, uint32_t channels)
+    : fd_(fd), format_(format), shm_(openShm(shm, ShmRing::Role::CONSUMER, 0.0, 1)),
+    blocking_(!(fcntl(fd, F_GETFL) & O_NONBLOCK)),
+    sampleType_(sampleType(format)),
+    textChannels_(max<uint32_t>(channels, 1)),
+    header_{}, headerRead_(format == Format::TEXT || format == Format::RAW), eof_(false),
+    buffer_(readBufferSize), begin_(0), end_(0), runLeft_(0)
+{
+    // raw frames are decoded like headed ones
+    if (format_ == Format::RAW)
+        header_.channels= textChannels_;
+}
+
+// Pulls more bytes from the fd, compacting any partial sample or line to the
+// front of the buffer first. Returns false when nothing new could be read.
+bool SampleReader::fill()
+{
+    if (begin_ > 0) {
+        memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_-= begin_;
+        begin_= 0;
+    }
+
+    if (end_ == buffer_.size())
+        buffer_.resize(buffer_.size() * 2);
+
+    while (true) {
+        ssize_t bytesRead= ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+
+        if (bytesRead > 0) {
+            end_+= bytesRead;
+            return true;
+        }
+
+        if (bytesRead == 0) {
+            eof_= true;
+            return false;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return false;
+
+        throw runtime_error(string("reading input: ") + strerror(errno));
+    }
+}
+
+bool SampleReader::readHeader()
+{
+    while (end_ - begin_ < sizeof(StreamHeader)) {
+        if (!fill()) {
+            if (eof_ && end_ != begin_)
+                throw runtime_error("truncated stream header");
+            return false;
+        }
+    }
+
+    memcpy(&header_, buffer_.data() + begin_, sizeof(StreamHeader));
+    if (memcmp(header_.magic, streamMagic, sizeof(streamMagic)) != 0)
+        throw runtime_error("missing stream header (is the upstream module using the same --format?)");
+
+    if (header_.version != streamVersion)
+        throw runtime_error("unsupported stream version " + to_string(header_.version));
+
+    // the header is authoritative: an f32 reader happily accepts an f64 stream
+    sampleType_= static_cast<SampleType>(header_.sampleType);
+    if (sampleType_ != SampleType::FLOAT32 && sampleType_ != SampleType::FLOAT64 && sampleType_ != SampleType::CONTROL)
+        throw runtime_error("unsupported sample type " + to_string(header_.sampleType));
+
+    runFrame_.assign(max<uint32_t>(header_.channels, 1), 0.0);
+
+    begin_+= sizeof(StreamHeader);
+    headerRead_= true;
+
+    return true;
+}
+
+template<typename Sample>
+size_t SampleReader::decodeText(Sample *dest, size_t count)
+{
+    size_t n= 0;
+
+    while (n + textChannels_ <= count && begin_ < end_) {
+        char *line= buffer_.data() + begin_;
+        char *newline= static_cast<char*>(memchr(line, '\n', end_ - begin_));
+
+        // a final line without a newline is only complete at end of stream
+        if (newline == nullptr && !eof_)
+            break;
+
+        size_t length= newline ? newline - line : end_ - begin_;
+        begin_+= newline ? length + 1 : length;
+
+        // Each column like `istream >> double`: leading blanks and a '+'
+        // are fine, anything after the frame's last column is ignored.
+        // Columns are separated by blanks or a comma.
+        const char *first= line;
+        const char *last= line + length;
+        uint32_t columns= 0;
+
+        while (columns < textChannels_) {
+            while (first < last && isspace(static_cast<unsigned char>(*first)))
+                ++first;
+            if (columns > 0 && first < last && *first == ',') {
+                ++first;
+                while (first < last && isspace(static_cast<unsigned char>(*first)))
+                    ++first;
+            }
+            if (first + 1 < last && *first == '+' && first[1] != '-')
+                ++first;
+
+            auto result= from_chars(first, last, dest[n + columns]);
+            if (result.ec != errc())
+                break;
+
+            first= result.ptr;
+            ++columns;
+        }
+
+        if (columns == textChannels_)
+            n+= columns;
+        else if (length > 0 && textChannels_ == 1)
+            cerr << "Skipping non-numeric line: " << string(line, length) << endl;
+        else if (length > 0)
+            cerr << "Skipping line without " << textChannels_ << " numeric columns: " << string(line, length) << endl;
+    }
+
+    return n;
+}
+
+uint32_t SampleReader::channels()
+{
+    if (shm_)
+        return shm_->channels();
+
+    if (format_ == Format::TEXT)
+        return textChannels_;
+
+    while (!headerRead_ && !readHeader() && !eof_)
+        waitReadable();
+
+    return (header_.channels > 0) ? header_.channels : 1;
+}
+
+// a non-blocking fd has nothing to read yet: sleep until it has
+void SampleReader::waitReadable()
+{
+    pollfd pfd{ fd_, POLLIN, 0 };
+    while (poll(&pfd, 1, -1) < 0 && errno == EINTR)
+        ;
+}
+
+template<typename Sample>
+size_t SampleReader::decodeBinary(Sample *dest, size_t count)
+{
+    size_t size= sampleSize(sampleType_);
+    size_t n= min(count, (end_ - begin_) / size);
+
+    if (header_.channels > 1)
+        n-= n % header_.channels;
+
+    const char *src= buffer_.data() + begin_;
+
+    if (size == sizeof(Sample)) {
+        memcpy(dest, src, n * sizeof(Sample));
+    } else if (sampleType_ == SampleType::FLOAT64) {
+        for (size_t i= 0; i < n; ++i) {
+            double sample;
+            memcpy(&sample, src + i * sizeof(double), sizeof(double));
+            dest[i]= static_cast<Sample>(sample);
+        }
+    } else {
+        for (size_t i= 0; i < n; ++i) {
+            float sample;
+            memcpy(&sample, src + i * sizeof(float), sizeof(float));
+            dest[i]= sample;
+        }
+    }
+
+    begin_+= n * size;
+
+    return n;
+}
+
+bool SampleReader::control()
+{
+    if (shm_ || format_ == Format::TEXT || format_ == Format::RAW)
+        return false;
+
+    channels();
+    return sampleType_ == SampleType::CONTROL;
+}
+
+// Starts the next run if its bytes are buffered; zero-length runs are
+// skipped.
+bool SampleReader::nextRun()
+{
+    size_t bytes= sizeof(uint32_t) + runFrame_.size() * sizeof(float);
+
+    while (runLeft_ == 0) {
+        if (end_ - begin_ < bytes)
+            return false;
+
+        const char *src= buffer_.data() + begin_;
+        uint32_t frames;
+        memcpy(&frames, src, sizeof(frames));
+        src+= sizeof(frames);
+
+        for (double &value : runFrame_) {
+            float sample;
+            memcpy(&sample, src, sizeof(float));
+            src+= sizeof(float);
+            value= sample;
+        }
+
+        runLeft_= frames;
+        begin_+= bytes;
+    }
+
+    return true;
+}
+
+template<typename Sample>
+size_t SampleReader::decodeControl(Sample *dest, size_t count)
+{
+    size_t channels= runFrame_.size();
+    size_t n= 0;
+
+    while (n + channels <= count && nextRun()) {
+        size_t frames= min(runLeft_, (count - n) / channels);
+
+        if (channels == 1) {
+            std::fill(dest + n, dest + n + frames, static_cast<Sample>(runFrame_[0]));
+        } else {
+            for (size_t i= 0; i < frames; ++i)
+                copy(runFrame_.begin(), runFrame_.end(), dest + n + i * channels);
+        }
+
+        n+= frames * channels;
+        runLeft_-= frames;
+    }
+
+    return n;
+}
+
+size_t SampleReader::readRuns(ControlRun *dest, size_t count)
+{
+    if (!control() || runFrame_.size() != 1)
+        throw runtime_error("runs can only be read from a single-channel ctl stream");
+
+    while (true) {
+        size_t n= 0;
+
+        while (n < count && nextRun()) {
+            dest[n++]= { runLeft_, runFrame_[0] };
+            runLeft_= 0;
+        }
+
+        if (n > 0 || eof_)
+            return n;
+
+        if (!fill() && !eof_)
+            return 0;
+    }
+}
+
+template<typename Sample>
+size_t SampleReader::read(Sample *dest, size_t count)
+{
+    if (shm_) {
+        size_t n;
+        if constexpr (is_same_v<Sample, double>) {
+            n= shm_->read(dest, count, blocking_);
+        } else {
+            widened_.resize(count);
+            n= shm_->read(widened_.data(), count, blocking_);
+            copy(widened_.begin(), widened_.begin() + n, dest);
+        }
+        eof_= (n == 0 && shm_->finished());
+        return n;
+    }
+
+    if (!headerRead_ && !readHeader())
+        return 0;
+
+    while (true) {
+        size_t n;
+        if (format_ == Format::TEXT)
+            n= decodeText(dest, count);
+        else if (sampleType_ == SampleType::CONTROL)
+            n= decodeControl(dest, count);
+        else
+            n= decodeBinary(dest, count);
+
+        if (n > 0 || eof_)
+            return n;
+
+        if (!fill() && !eof_)
+            return 0;
+    }
+}
+
+SampleWriter::SampleWriter(int fd, Format format, double sampleRate, uint32_t channels, const string &shm)
+    : fd_(fd), format_(format), shm_(openShm(shm, ShmRing::Role::PRODUCER, sampleRate, channels)),
+    buffer_(flushSize), flushed_(0), used_(0), channels_(max<uint32_t>(channels, 1)), column_(0),
+    position_(0), runFrames_(0), runFrame_(channels_, 0.0)
+{
+    if (shm_)
+        return;
+
+    tunePipe(fd_);
+
+    if (format_ != Format::F32 && format_ != Format::F64 && format_ != Format::CTL)
+        return;
+
+    StreamHeader header;
+    memcpy(header.magic, streamMagic, sizeof(streamMagic));
+    header.version= streamVersion;
+    header.sampleType= static_cast<uint16_t>(sampleType(format_));
+    header.channels= channels;
+    header.sampleRate= static_cast<uint32_t>(sampleRate);
+
+    memcpy(buffer_.data(), &header, sizeof(header));
+    used_= sizeof(header);
+}
+
+SampleWriter::~SampleWriter()
+{
+    try {
+        flush();
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+    }
+}
+
+// Makes room for bytes at used_, flushing first if they would not fit.
+void SampleWriter::reserve(size_t bytes)
+{
+    if (used_ + bytes > buffer_.size())
+        flush();
+}
+
+// Writes the held frame's pending frames as one run (or several, should
+// they overflow the uint32 count).
+void SampleWriter::emitRun()
+{
+    size_t bytes= sizeof(uint32_t) + channels_ * sizeof(float);
+
+    while (runFrames_ > 0) {
+        uint32_t frames= static_cast<uint32_t>(min<size_t>(runFrames_, UINT32_MAX));
+        runFrames_-= frames;
+
+        // reserve() may flush, which must not see this run again
+        reserve(bytes);
+        char *dest= buffer_.data() + used_;
+        memcpy(dest, &frames, sizeof(frames));
+        dest+= sizeof(frames);
+
+        for (double value : runFrame_) {
+            float sample= static_cast<float>(value);
+            memcpy(dest, &sample, sizeof(float));
+            dest+= sizeof(float);
+        }
+        used_+= bytes;
+    }
+}
+
+// a new held frame: ends the pending run unless the values are the same
+void SampleWriter::holdFrame(const double *frame)
+{
+    if (equal(runFrame_.begin(), runFrame_.end(), frame))
+        return;
+
+    emitRun();
+    copy(frame, frame + channels_, runFrame_.begin());
+}
+
+// Samples frames to control rate: the frame at the start of each control
+// period is held for the whole period.
+void SampleWriter::writeControl(const double *src, size_t frames)
+{
+    while (frames > 0) {
+        size_t phase= position_ % controlPeriod;
+        if (phase == 0)
+            holdFrame(src);
+
+        size_t n= min(frames, controlPeriod - phase);
+        runFrames_+= n;
+        position_+= n;
+        src+= n * channels_;
+        frames-= n;
+    }
+}
+
+void SampleWriter::writeRun(const double *frame, size_t frames)
+{
+    if (format_ == Format::CTL && !shm_) {
+        holdFrame(frame);
+        runFrames_+= frames;
+        position_+= frames;
+        return;
+    }
+
+    // other formats carry every sample; the copies are built once
+    static constexpr size_t chunkFrames= 256;
+    size_t chunk= min(frames, chunkFrames);
+
+    if (expanded_.size() < chunk * channels_ || !equal(frame, frame + channels_, expanded_.begin())) {
+        expanded_.resize(chunkFrames * channels_);
+        for (size_t i= 0; i < expanded_.size(); i+= channels_)
+            copy(frame, frame + channels_, expanded_.begin() + i);
+    }
+
+    while (frames > 0) {
+        size_t n= min(frames, chunkFrames);
+        write(expanded_.data(), n * channels_);
+        frames-= n;
+    }
+}
+
+template<typename Sample>
+void SampleWriter::write(const Sample *src, size_t count)
+{
+    if (shm_ || format_ == Format::CTL) {
+        if constexpr (is_same_v<Sample, double>) {
+            if (shm_)
+                shm_->write(src, count);
+            else
+                writeControl(src, count / channels_);
+        } else {
+            // the ring and the control runs take doubles: floats go in by
+            // chunks of whole frames
+            static constexpr size_t chunkFrames= 256;
+            widened_.resize(chunkFrames * channels_);
+
+            while (count > 0) {
+                size_t n= min(count, widened_.size());
+                copy(src, src + n, widened_.begin());
+                write(widened_.data(), n);
+                src+= n;
+                count-= n;
+            }
+        }
+        return;
+    }
+
+    if (format_ == Format::TEXT) {
+        for (size_t i= 0; i < count; ++i) {
+            // general with precision 6 is %g, the default ostream formatting
+            // of the text protocol
+            reserve(32);
+            char *first= buffer_.data() + used_;
+            char *last= to_chars(first, first + 31, src[i], chars_format::general, 6).ptr;
+            // interleaved channels go in columns, one frame per line
+            if (++column_ == channels_)
+                column_= 0;
+            *last++= (column_ == 0) ? '\n' : ' ';
+            used_= last - buffer_.data();
+        }
+        return;
+    }
+
+    size_t size= (format_ == Format::F64) ? sizeof(double) : sizeof(float);
+
+    while (count > 0) {
+        reserve(size);
+
+        size_t room= buffer_.size() - used_;
+        size_t n= min(count, room / size);
+        char *dest= buffer_.data() + used_;
+
+        if (size == sizeof(Sample)) {
+            memcpy(dest, src, n * sizeof(Sample));
+        } else if (format_ == Format::F64) {
+            for (size_t i= 0; i < n; ++i) {
+                double sample= src[i];
+                memcpy(dest + i * sizeof(double), &sample, sizeof(double));
+            }
+        } else {
+            for (size_t i= 0; i < n; ++i) {
+                float sample= static_cast<float>(src[i]);
+                memcpy(dest + i * sizeof(float), &sample, sizeof(float));
+            }
+        }
+
+        used_+= n * size;
+        src+= n;
+        count-= n;
+    }
+}
+
+void SampleWriter::flush()
+{
+    // a held frame goes out with each flush, so control changes are never
+    // kept back longer than other samples
+    if (runFrames_ > 0)
+        emitRun();
+
+    while (flushed_ < used_) {
+        ssize_t n= ::write(fd_, buffer_.data() + flushed_, used_ - flushed_);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            flushed_= used_= 0;
+            throw runtime_error(string("writing output: ") + strerror(errno));
+        }
+
+        flushed_+= n;
+    }
+
+    // write() copied the bytes into the pipe, so the buffer starts over
+    flushed_= used_= 0;
+}
+
+template size_t SampleReader::read(double *dest, size_t count);
+template size_t SampleReader::read(float *dest, size_t count);
+template void SampleWriter::write(const double *src, size_t count);
+template void SampleWriter::write(const float *src, size_t count);
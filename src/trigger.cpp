@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "trigger.hpp"
+
+using namespace std;
+
+Trigger::Trigger(float level, float hysteresis, Edge edge, uint64_t holdoff, size_t history)
+    : level_(level), hysteresis_(hysteresis), edge_(edge), holdoff_(holdoff),
+    armedRising_(false), armedFalling_(false), position_(0), nextAllowed_(0),
+    index_(bit_ceil(max<size_t>(history, 1))), recorded_(0)
+{
+}
+
+void Trigger::record()
+{
+    if (position_ >= nextAllowed_) {
+        index_[recorded_++ & (index_.size() - 1)]= position_;
+        nextAllowed_= position_ + holdoff_;
+    }
+}
+
+void Trigger::process(const float *samples, size_t count)
+{
+    bool rising= (edge_ != Edge::FALLING);
+    bool falling= (edge_ != Edge::RISING);
+    float low= level_ - hysteresis_;
+    float high= level_ + hysteresis_;
+
+    for (size_t i= 0; i < count; ++i, ++position_) {
+        float s= samples[i];
+
+        if (rising) {
+            if (s < low) {
+                armedRising_= true;
+            } else if (armedRising_ && s >= level_) {
+                armedRising_= false;
+                record();
+            }
+        }
+
+        if (falling) {
+            if (s > high) {
+                armedFalling_= true;
+            } else if (armedFalling_ && s <= level_) {
+                armedFalling_= false;
+                record();
+            }
+        }
+    }
+}
+
+optional<uint64_t> Trigger::latest(uint64_t limit) const
+{
+    // positions are increasing, so binary search what is left in the ring
+    uint64_t first= recorded_ > index_.size() ? recorded_ - index_.size() : 0;
+    uint64_t last= recorded_;
+    size_t mask= index_.size() - 1;
+
+    while (first < last) {
+        uint64_t middle= first + (last - first) / 2;
+        if (index_[middle & mask] <= limit)
+            first= middle + 1;
+        else
+            last= middle;
+    }
+
+    uint64_t oldest= recorded_ > index_.size() ? recorded_ - index_.size() : 0;
+    if (first == oldest)
+        return nullopt;
+
+    return index_[(first - 1) & mask];
+}
+
+Trigger::Edge parseTriggerEdge(const string &s)
+{
+    if (s == "rising")
+        return Trigger::Edge::RISING;
+
+    if (s == "falling")
+        return Trigger::Edge::FALLING;
+
+    if (s == "both")
+        return Trigger::Edge::BOTH;
+
+    throw runtime_error("trigger_edge must be 'rising', 'falling' or 'both'");
+}
+
+Trigger::Mode parseTriggerMode(const string &s)
+{
+    if (s == "auto")
+        return Trigger::Mode::AUTO;
+
+    if (s == "normal")
+        return Trigger::Mode::NORMAL;
+
+    if (s == "single")
+        return Trigger::Mode::SINGLE;
+
+    throw runtime_error("trigger_mode must be 'auto', 'normal' or 'single'");
+}
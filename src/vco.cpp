@@ -1,12 +1,149 @@
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
 
-#include <argparse/argparse.hpp>
-
+#include "biquad.hpp"
 #include "vco.hpp"
+#include "wavetable.hpp"
 
 using namespace std;
 
+#if defined(__x86_64__) || defined(__i386__)
+#define VCO_X86 1
+#endif
+
+namespace {
+
+// Width of the block sine kernel; each target below compiles the W lanes
+// into its own register width. Float blocks take twice the lanes.
+constexpr size_t W= 4;
+constexpr size_t FW= 2 * W;
+
+typedef double vecd __attribute__((vector_size(W * sizeof(double))));
+typedef double vecw __attribute__((vector_size(FW * sizeof(double))));
+typedef float vecf __attribute__((vector_size(FW * sizeof(float))));
+
+template<typename Sample>
+using SineFunction= void (*)(const double *phase, Sample *out, size_t n, double amplitude);
+
+// 2 pi in two parts, the high one rounded to float so turns * twoPiHi is
+// exact, and the rounding shift of fastmath.hpp
+constexpr double twoPiHi= 6.2831854820251464844;
+constexpr double twoPiLo= -1.7484556000744970666e-07;
+constexpr double invTwoPi= 0.15915494309189533577;
+constexpr double roundShift= 0x1.8p52;
+
+// phase less the nearest whole number of turns, in [-pi, pi]; by
+// reference like fastmath.hpp
+template<typename T>
+[[gnu::always_inline]] inline void wrapPhase(const T &phase, T &wrapped)
+{
+    T turns= phase * invTwoPi + roundShift;
+    turns-= roundShift;
+
+    wrapped= (phase - turns * twoPiHi) - turns * twoPiLo;
+}
+
+// The tail runs through the scalar overload, which gives the same bits as
+// a lane, so a block matches generateSineWave() sample by sample. libm has
+// no vector form and takes the plain loop.
+template<Precision P>
+[[gnu::always_inline]] inline void sineLanes(const double *phase, double *out, size_t n, double amplitude)
+{
+    size_t i= 0;
+
+    if constexpr (P != Precision::FULL) {
+        for (; i + W <= n; i+= W) {
+            vecd x, y;
+            memcpy(&x, phase + i, sizeof(x));
+            fastmath::sin<P>(x, y);
+            y*= amplitude;
+            memcpy(out + i, &y, sizeof(y));
+        }
+    }
+
+    for (; i < n; ++i)
+        out[i]= amplitude * fastmath::sin<P>(phase[i]);
+}
+
+// Float blocks: the phase is wrapped in double, where it keeps its fraction
+// of a turn, and only the wrapped phase goes to float.
+template<Precision P>
+[[gnu::always_inline]] inline void sineLanes(const double *phase, float *out, size_t n, double amplitude)
+{
+    size_t i= 0;
+
+    if constexpr (P == Precision::FULL) {
+        for (; i < n; ++i)
+            out[i]= static_cast<float>(amplitude * sin(phase[i]));
+    } else {
+        float gain= static_cast<float>(amplitude);
+
+        for (; i + FW <= n; i+= FW) {
+            vecw p;
+            memcpy(&p, phase + i, sizeof(p));
+            wrapPhase(p, p);
+            vecf x= __builtin_convertvector(p, vecf), y;
+            fastmath::sin<P>(x, y);
+            y*= gain;
+            memcpy(out + i, &y, sizeof(y));
+        }
+
+        for (; i < n; ++i) {
+            double p;
+            wrapPhase(phase[i], p);
+            out[i]= gain * fastmath::sin<P>(static_cast<float>(p));
+        }
+    }
+}
+
+template<Precision P, typename Sample>
+void sineGeneric(const double *phase, Sample *out, size_t n, double amplitude)
+{
+    sineLanes<P>(phase, out, n, amplitude);
+}
+
+#ifdef VCO_X86
+template<Precision P, typename Sample>
+__attribute__((target("avx2")))
+void sineAvx2(const double *phase, Sample *out, size_t n, double amplitude)
+{
+    sineLanes<P>(phase, out, n, amplitude);
+}
+#endif
+
+template<typename Sample>
+SineFunction<Sample> selectSine(Precision precision, SimdLevel level)
+{
+#ifdef VCO_X86
+    if (level >= SimdLevel::AVX2) {
+        if (precision == Precision::LOW)
+            return sineAvx2<Precision::LOW, Sample>;
+        if (precision == Precision::HIGH)
+            return sineAvx2<Precision::HIGH, Sample>;
+    }
+#else
+    (void)level;
+#endif
+
+    switch (precision) {
+        case Precision::LOW:
+            return sineGeneric<Precision::LOW, Sample>;
+        case Precision::HIGH:
+            return sineGeneric<Precision::HIGH, Sample>;
+        default:
+            return sineGeneric<Precision::FULL, Sample>;
+    }
+}
+
+// phases of a float block of naive sines that are wrapped at a time
+constexpr size_t sineChunk= 256;
+
+} // namespace
+
 Vco::WaveType parseWaveType(const string& value) {
 
     if(value == "sine")
@@ -19,23 +156,123 @@ Vco::WaveType parseWaveType(const string& value) {
         throw runtime_error("Invalid wave type");
 }
 
-Vco::Vco(double sampleRate, double sensitivity, double amplitude) {
+Vco::Engine parseEngine(const string& value) {
+
+    if(value == "naive")
+        return Vco::Engine::NAIVE;
+    else if(value == "wavetable")
+        return Vco::Engine::WAVETABLE;
+    else if(value == "polyblep")
+        return Vco::Engine::POLYBLEP;
+    else
+        throw runtime_error("Invalid engine: must be 'naive', 'wavetable', or 'polyblep'");
+}
+
+template<typename Sample>
+BasicVco<Sample>::BasicVco(double sampleRate, double sensitivity, double amplitude, Engine engine, Precision precision) {
 
     sampleRate_= sampleRate;
     sensitivity_= sensitivity;
     amplitude_= amplitude;
+    phase_= 0.0;
+    engine_= engine;
+    tables_= (engine == Engine::WAVETABLE) ? &WavetableSet::shared() : nullptr;
+    precision_= precision;
+    sineBlock_= selectSine<Sample>(precision, detectSimd());
+}
+
+template<typename Sample>
+double BasicVco<Sample>::sine(double x) const {
+
+    switch(precision_) {
+        case Precision::LOW:
+            return fastmath::sin<Precision::LOW>(x);
+        case Precision::HIGH:
+            return fastmath::sin<Precision::HIGH>(x);
+        default:
+            return sin(x);
+    }
+}
+
+// polynomial band-limited step residual around a discontinuity at t = 0
+static double polyBlep(double t, double dt) {
+
+    if(t < dt) {
+        t/= dt;
+        return t + t - t * t - 1.0;
+    }
+    if(t > 1.0 - dt) {
+        t= (t - 1.0) / dt;
+        return t * t + t + t + 1.0;
+    }
+    return 0.0;
+}
+
+// integrated polyBLEP: residual for a unit change of slope at t = 0
+static double polyBlamp(double t, double dt) {
+
+    if(t < dt) {
+        t= t / dt - 1.0;
+        return -t * t * t / 6.0;
+    }
+    if(t > 1.0 - dt) {
+        t= (t - 1.0) / dt + 1.0;
+        return t * t * t / 6.0;
+    }
+    return 0.0;
+}
+
+template<typename Sample>
+double BasicVco<Sample>::generateBandLimited(double frequency, WaveType waveType) {
+
+    double increment= frequency / sampleRate_;
+
+    phase_+= increment;
+    phase_-= floor(phase_);
+    if(phase_ >= 1.0)
+        phase_= 0.0;
+
+    if(engine_ == Engine::WAVETABLE)
+        return (*tables_)[waveType].lookup(phase_, frequency, sampleRate_);
+
+    double dt= min(fabs(increment), 0.5);
+    double half= (phase_ < 0.5) ? phase_ + 0.5 : phase_ - 0.5;
+
+    switch(waveType) {
+        case Vco::WaveType::TRIANGLE:
+            // slope (per unit phase) drops by 8 at phase 0 and rises by 8 at 0.5
+            return 4.0 * fabs(phase_ - 0.5) - 1.0
+                - 8.0 * dt * polyBlamp(phase_, dt)
+                + 8.0 * dt * polyBlamp(half, dt);
+        case Vco::WaveType::SQUARE:
+            return ((phase_ < 0.5) ? 1.0 : -1.0) + polyBlep(phase_, dt) - polyBlep(half, dt);
+        default:
+            return sine(2.0 * M_PI * phase_);
+    }
+}
+
+// fmod() leaves an increment below a full turn unchanged, so it is only
+// called for frequencies above the sample rate
+template<typename Sample>
+void BasicVco<Sample>::advanceSine(double frequency) {
+
+    double increment= (2.0 * M_PI * frequency) / sampleRate_;
+
+    phase_+= (fabs(increment) < 2.0 * M_PI) ? increment : fmod(increment, 2.0 * M_PI);
 }
 
-double Vco::generateSineWave(double frequency) {
+template<typename Sample>
+double BasicVco<Sample>::generateSineWave(double frequency) {
 
-    phase_+= fmod((2.0 * M_PI * frequency) / sampleRate_, 2.0 * M_PI);
+    advanceSine(frequency);
 
-    double sine_wave= sin(phase_);
+    double sine_wave= sine(phase_);
 
     return sine_wave;
 }
 
-double Vco::generateTriangleWave(double frequency) {
+template<typename Sample>
+double BasicVco<Sample>::generateTriangleWave(double frequency) {
 
     phase_+= (2.0 * frequency) / sampleRate_;
     if(phase_ >= 1.0)
@@ -46,7 +283,8 @@ double Vco::generateTriangleWave(double frequency) {
     return triangle_wave;
 }
 
-double Vco::generateSquareWave(double frequency) {
+template<typename Sample>
+double BasicVco<Sample>::generateSquareWave(double frequency) {
 
     phase_+= frequency / sampleRate_;
     if (phase_ >= 1.0) 
@@ -57,11 +295,15 @@ double Vco::generateSquareWave(double frequency) {
     return square_wave;
 }
 
-double Vco::generateWaveForm(double controlVoltage, Vco::WaveType waveType) {
+template<typename Sample>
+double BasicVco<Sample>::generateWaveForm(double controlVoltage, WaveType waveType) {
     
     double waveForm;
     double frequency= sensitivity_ * controlVoltage;
 
+    if(engine_ != Engine::NAIVE)
+        return amplitude_ * generateBandLimited(frequency, waveType);
+
     switch(waveType) {
         case Vco::WaveType::SINE:
             waveForm= generateSineWave(frequency);
@@ -84,50 +326,63 @@ double Vco::generateWaveForm(double controlVoltage, Vco::WaveType waveType) {
     return (double)NULL;
 }
 
-int main(int argc, char *argv[]) {
-
-   string line;
-   double controlVoltage;
-   double sampleRate;
-   double sensitivity;
-   double amplitude;
-
-   argparse::ArgumentParser args("Vco");
-   args.add_argument("--sensitivity").default_value(1.0).help("control voltage sensitivity").scan<'g', double>();
-   args.add_argument("--sample_rate").default_value(48000.0).help("sampling rate").scan<'g', double>();
-   args.add_argument("--amplitude").default_value(1.0).help("amplitude").scan<'g', double>();
-   args.add_argument("--wave_type").default_value(string("sine")).help("sine, triangle, square").action([](const string &value) {
-
-       if (value != "sine" && value != "triangle" && value != "square") 
-           throw runtime_error("Invalid wave type: must be 'sine', 'triangle', or 'square'");
-
-      return value;
-   });
+template<typename Sample>
+void BasicVco<Sample>::generateWaveForm(const Sample *controlVoltage, Sample *out, size_t n, WaveType waveType) {
 
+    if(engine_ != Engine::NAIVE) {
+        for(size_t i= 0; i < n; ++i)
+            out[i]= static_cast<Sample>(amplitude_ * generateBandLimited(sensitivity_ * controlVoltage[i], waveType));
+        return;
+    }
 
-   try {
-       args.parse_args(argc, argv);
-   } catch (const exception &err) {
-      cerr << err.what() << endl;
-      cerr << args;
-      return EXIT_FAILURE;
-   }
+    switch(waveType) {
+        case Vco::WaveType::SINE:
+            // the phases first, then the sines over the whole block
+            if constexpr(is_same_v<Sample, double>) {
+                for(size_t i= 0; i < n; ++i) {
+                    advanceSine(sensitivity_ * controlVoltage[i]);
+                    out[i]= phase_;
+                }
+                sineBlock_(out, out, n, amplitude_);
+            } else {
+                double phases[sineChunk];
+                for(size_t begin= 0; begin < n; begin+= sineChunk) {
+                    size_t m= min(sineChunk, n - begin);
+                    for(size_t i= 0; i < m; ++i) {
+                        advanceSine(sensitivity_ * controlVoltage[begin + i]);
+                        phases[i]= phase_;
+                    }
+                    sineBlock_(phases, out + begin, m, amplitude_);
+                }
+            }
+            break;
+        case Vco::WaveType::TRIANGLE:
+            for(size_t i= 0; i < n; ++i)
+                out[i]= static_cast<Sample>(amplitude_ * generateTriangleWave(sensitivity_ * controlVoltage[i]));
+            break;
+        case Vco::WaveType::SQUARE:
+            for(size_t i= 0; i < n; ++i)
+                out[i]= static_cast<Sample>(amplitude_ * generateSquareWave(sensitivity_ * controlVoltage[i]));
+            break;
+        default:
+            cerr << "Unknown Wave Type" << endl;
+            fill(out, out + n, Sample(0.0));
+            break;
+    }
+}
 
-   sensitivity= args.get<double>("sensitivity");
-   sampleRate= args.get<double>("sample_rate");
-   amplitude= args.get<double>("amplitude");
-   Vco::WaveType waveType= parseWaveType(args.get<string>("wave_type"));
+template<typename Sample>
+void BasicVco<Sample>::generateWaveForm(double controlVoltage, Sample *out, size_t n, WaveType waveType) {
 
-   Vco vco(sampleRate, sensitivity, amplitude);
+    controlVoltage_.set(controlVoltage);
 
-    while (getline(cin, line)) {
-        istringstream iss(line);
-        if (iss >> controlVoltage) {
-            cout << vco.generateWaveForm(controlVoltage, waveType) << '\n';
-        } else {
-            cerr << "Skipping non-numeric line: " << line << endl;
-        }
-    }
+    size_t i= 0;
+    for(; i < n && !controlVoltage_.settled(); ++i)
+        out[i]= static_cast<Sample>(generateWaveForm(controlVoltage_.next(), waveType));
 
-   return EXIT_SUCCESS;
+    for(; i < n; ++i)
+        out[i]= static_cast<Sample>(generateWaveForm(controlVoltage, waveType));
 }
+
+template class BasicVco<double>;
+template class BasicVco<float>;
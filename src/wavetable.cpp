@@ -0,0 +1,160 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "wavetable.hpp"
+
+using namespace std;
+
+static constexpr char cacheMagic[4]= { 'C', 'L', 'W', 'T' };
+static constexpr uint32_t cacheVersion= 1;
+static constexpr size_t levelStride= Wavetable::tableSize + 1;
+
+Wavetable::Wavetable(Vco::WaveType waveType)
+    : data_(levelStride * levels, 0.0)
+{
+    // harmonic n at sample i is sin(2 pi n i / N), i.e. an exact lookup at
+    // index (n * i) mod N in a single sine table
+    vector<double> sine(tableSize);
+    for (size_t i= 0; i < tableSize; ++i)
+        sine[i]= sin(2.0 * M_PI * i / tableSize);
+
+    auto cosine= [&](size_t index) { return sine[(index + tableSize / 4) % tableSize]; };
+
+    // build from the top level (one harmonic) down, adding the harmonics
+    // each richer level brings on top of the previous one
+    vector<double> sum(tableSize, 0.0);
+    size_t harmonics= 0;
+
+    for (size_t k= levels; k-- > 0;) {
+        size_t limit= maxHarmonics >> k;
+
+        for (size_t n= harmonics + 1; n <= limit; ++n) {
+            for (size_t i= 0; i < tableSize; ++i) {
+                size_t index= (n * i) % tableSize;
+
+                switch (waveType) {
+                    case Vco::WaveType::SINE:
+                        if (n == 1)
+                            sum[i]+= sine[index];
+                        break;
+                    case Vco::WaveType::TRIANGLE:
+                        // matches 4|phase - 0.5| - 1: +1 at phase 0
+                        if (n & 1)
+                            sum[i]+= 8.0 / (M_PI * M_PI * n * n) * cosine(index);
+                        break;
+                    case Vco::WaveType::SQUARE:
+                        // matches +1 for phase < 0.5, -1 after
+                        if (n & 1)
+                            sum[i]+= 4.0 / (M_PI * n) * sine[index];
+                        break;
+                }
+            }
+        }
+
+        harmonics= limit;
+        copy(sum.begin(), sum.end(), data_.begin() + k * levelStride);
+        data_[k * levelStride + tableSize]= sum[0];
+    }
+}
+
+Wavetable::Wavetable(Vco::WaveType, vector<double> data)
+    : data_(move(data))
+{
+    if (data_.size() != levelStride * levels)
+        throw runtime_error("wavetable has the wrong size");
+}
+
+const double *Wavetable::level(double frequency, double sampleRate) const
+{
+    // the richest level whose top harmonic stays below Nyquist
+    double ratio= fabs(frequency) * maxHarmonics / (0.5 * sampleRate);
+    size_t k= 0;
+
+    if (ratio > 1.0) {
+        int exponent;
+        double mantissa= frexp(ratio, &exponent);
+        k= (mantissa > 0.5) ? exponent : exponent - 1;
+        k= min(k, levels - 1);
+    }
+
+    return data_.data() + k * levelStride;
+}
+
+WavetableSet::WavetableSet()
+{
+    for (auto waveType : { Vco::WaveType::SINE, Vco::WaveType::TRIANGLE, Vco::WaveType::SQUARE })
+        tables_.emplace_back(waveType);
+}
+
+WavetableSet::WavetableSet(vector<Wavetable> tables)
+    : tables_(move(tables))
+{
+}
+
+const WavetableSet &WavetableSet::shared(const string &cachePath)
+{
+    static const WavetableSet set= [&]() {
+        if (cachePath.empty())
+            return WavetableSet();
+
+        try {
+            return load(cachePath);
+        } catch (const exception &) {
+            WavetableSet built;
+            try {
+                built.save(cachePath);
+            } catch (const exception &err) {
+                cerr << err.what() << endl;
+            }
+            return built;
+        }
+    }();
+
+    return set;
+}
+
+WavetableSet WavetableSet::load(const string &path)
+{
+    ifstream file(path, ios::binary);
+    char magic[4];
+    uint32_t version, tableSize, levels, count;
+
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&tableSize), sizeof(tableSize));
+    file.read(reinterpret_cast<char*>(&levels), sizeof(levels));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if (!file || memcmp(magic, cacheMagic, sizeof(cacheMagic)) != 0 || version != cacheVersion
+        || tableSize != Wavetable::tableSize || levels != Wavetable::levels || count != 3)
+        throw runtime_error("invalid wavetable cache: " + path);
+
+    vector<Wavetable> tables;
+    for (auto waveType : { Vco::WaveType::SINE, Vco::WaveType::TRIANGLE, Vco::WaveType::SQUARE }) {
+        vector<double> data(levelStride * Wavetable::levels);
+        file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(double));
+        if (!file)
+            throw runtime_error("truncated wavetable cache: " + path);
+        tables.emplace_back(waveType, move(data));
+    }
+
+    return WavetableSet(move(tables));
+}
+
+void WavetableSet::save(const string &path) const
+{
+    ofstream file(path, ios::binary);
+    uint32_t header[4]= { cacheVersion, Wavetable::tableSize, Wavetable::levels, static_cast<uint32_t>(tables_.size()) };
+
+    file.write(cacheMagic, sizeof(cacheMagic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (const auto &table : tables_)
+        file.write(reinterpret_cast<const char*>(table.data().data()), table.data().size() * sizeof(double));
+
+    if (!file)
+        throw runtime_error("cannot write wavetable cache: " + path);
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <unistd.h>
+
+#include <argparse/argparse.hpp>
+
+#include "cv.hpp"
+#include "pacer.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+
+   double sampleRate;
+   double amplitude;
+   double duration;
+
+   argparse::ArgumentParser args("Cv");
+   args.add_argument("--sampleRate").default_value(48000.0).help("sampling rate").scan<'g', double>();
+   args.add_argument("--amplitude").default_value(1.0).help("amplitude").scan<'g', double>();
+   args.add_argument("--duration").default_value(1.0).help("duratione").scan<'g', double>();
+   args.add_argument("--format").default_value(string("text")).help("text, raw, f32, f64, ctl").action([](const string &value) {
+       parseFormat(value);
+       return value;
+   });
+   args.add_argument("--block_size").default_value(256).help("samples generated per block").scan<'i', int>();
+   args.add_argument("--shm_out").default_value(string("")).help("write to the shared-memory ring NAME instead of stdout");
+   args.add_argument("--realtime").default_value(false).implicit_value(true).help("pace output to the wall clock (default)");
+   args.add_argument("--offline").default_value(false).implicit_value(true).help("no pacing, render as fast as possible");
+   args.add_argument("--clock-from-downstream").default_value(false).implicit_value(true).help("no pacing, rely on pipe backpressure");
+
+
+   try {
+       args.parse_args(argc, argv);
+   } catch (const exception &err) {
+      cerr << err.what() << endl;
+      cerr << args;
+      return EXIT_FAILURE;
+   }
+
+   sampleRate= args.get<double>("sampleRate");
+   amplitude= args.get<double>("amplitude");
+   duration= args.get<double>("duration");
+
+   Format format= parseFormat(args.get<string>("format"));
+   int blockSize= args.get<int>("block_size");
+
+   if (blockSize < 1) {
+      cerr << "block_size must be at least 1" << endl;
+      return EXIT_FAILURE;
+   }
+
+   Pacer::Mode pacing;
+   try {
+      pacing= parsePacing(args.get<bool>("realtime"), args.get<bool>("offline"), args.get<bool>("clock-from-downstream"), Pacer::Mode::REALTIME);
+   } catch (const exception &err) {
+      cerr << err.what() << endl;
+      return EXIT_FAILURE;
+   }
+
+   SampleWriter writer(STDOUT_FILENO, format, sampleRate, 1, args.get<string>("shm_out"));
+   Pacer pacer(pacing, sampleRate);
+   Cv cv(sampleRate, amplitude);
+   cv.process(duration, writer, pacer, blockSize);
+   pacer.report("cv");
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <exception>
+#include <vector>
+#include <unistd.h>
+
+#include <argparse/argparse.hpp>
+
+#include "env.hpp"
+#include "pacer.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+// renders the gate of reader in blocks of Sample
+template<typename Sample>
+static void render(ADSR &env, Pacer &pacer, SampleReader &reader, SampleWriter &writer, size_t blockSize) {
+
+    vector<Sample> block(blockSize);
+    size_t n;
+
+    if(reader.control()) {
+        // control-rate gate: edges only fall on run boundaries
+        ControlRun run;
+        while(reader.readRuns(&run, 1) > 0) {
+            for(size_t i= 0; i < run.frames; i+= n) {
+                n= min(block.size(), run.frames - i);
+                pacer.wait(n);
+
+                env.process(run.value, block.data(), n);
+                writer.write(block.data(), n);
+
+                if(pacer.flushEachBlock())
+                    writer.flush();
+            }
+        }
+    } else {
+        while((n= reader.read(block.data(), block.size())) > 0) {
+            pacer.wait(n);
+
+            env.process(block.data(), block.data(), n);
+            writer.write(block.data(), n);
+
+            if(pacer.flushEachBlock())
+                writer.flush();
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+
+    argparse::ArgumentParser args("env");
+
+    args.add_argument("--attack").default_value(0.01f).help("attack").scan<'g', float>();
+    args.add_argument("--decay").default_value(0.1f).help("decay").scan<'g', float>();
+    args.add_argument("--sustain").default_value(0.7f).help("sustain").scan<'g', float>();
+    args.add_argument("--release").default_value(0.3f).help("release").scan<'g', float>();
+    args.add_argument("--sample_rate").default_value(48000).help("sample_rate").scan<'i', int>();
+    args.add_argument("--format").default_value(string("text")).help("text, raw, f32, f64, ctl").action([](const string &value) {
+        parseFormat(value);
+        return value;
+    });
+    args.add_argument("--sample_type").default_value(string("double")).help("double, float: the type of the processed blocks").action([](const string &value) {
+        parseProcessingType(value);
+        return value;
+    });
+    args.add_argument("--block_size").default_value(256).help("samples processed per block").scan<'i', int>();
+    args.add_argument("--shm_in").default_value(string("")).help("read from the shared-memory ring NAME instead of stdin");
+    args.add_argument("--shm_out").default_value(string("")).help("write to the shared-memory ring NAME instead of stdout");
+    args.add_argument("--realtime").default_value(false).implicit_value(true).help("pace output to the wall clock (default)");
+    args.add_argument("--offline").default_value(false).implicit_value(true).help("no pacing, process as fast as possible");
+    args.add_argument("--clock-from-downstream").default_value(false).implicit_value(true).help("no pacing, rely on pipe backpressure");
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &err) {
+       cerr << err.what() << endl;
+       cerr << args;
+       return EXIT_FAILURE;
+    }
+
+    float attack= args.get<float>("attack");
+    float decay= args.get<float>("decay");
+    float sustain= args.get<float>("sustain");
+    float release= args.get<float>("release");
+    int sampleRate= args.get<int>("sample_rate");
+    Format format= parseFormat(args.get<string>("format"));
+    int blockSize= args.get<int>("block_size");
+    ProcessingType sampleType= parseProcessingType(args.get<string>("sample_type"));
+
+    if(blockSize < 1) {
+        cerr << "block_size must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+
+    Pacer::Mode pacing;
+    try {
+        pacing= parsePacing(args.get<bool>("realtime"), args.get<bool>("offline"), args.get<bool>("clock-from-downstream"), Pacer::Mode::REALTIME);
+    } catch (const exception &err) {
+        cerr << err.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    Pacer pacer(pacing, sampleRate);
+    ADSR env {attack, decay, sustain, release, sampleRate};
+    env.note_on();
+
+    SampleReader reader(STDIN_FILENO, format, args.get<string>("shm_in"));
+    SampleWriter writer(STDOUT_FILENO, format, sampleRate, 1, args.get<string>("shm_out"));
+
+    try {
+        if(sampleType == ProcessingType::FLOAT)
+            render<float>(env, pacer, reader, writer, blockSize);
+        else
+            render<double>(env, pacer, reader, writer, blockSize);
+    } catch (const exception &err) {
+        cerr << err.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    pacer.report("env");
+    return EXIT_SUCCESS;
+} 
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <type_traits>
+#include <argparse/argparse.hpp>
+#include <unistd.h>
+
+#include "filter.hpp"
+#include "filtercascade.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+struct Stream {
+    SampleReader &reader;
+    Format format;
+    double fs;
+    string shmOut;
+    size_t blockSize;
+    SimdLevel simd;
+};
+
+// Filters the input in blocks of Sample: mono, modulated by the extra
+// channels, or several channels through a bank.
+template<typename Sample>
+static void run(BasicFilter<Sample> filter, Stream &stream, bool cutoffCv, bool qCv)
+{
+    const uint32_t modulatedChannels= 1 + cutoffCv + qCv;
+    const size_t channels= stream.reader.channels();
+    size_t n;
+
+    if (modulatedChannels > 1) {
+        if (channels != modulatedChannels)
+            throw runtime_error("--cutoff_cv/--q_cv expect " + to_string(modulatedChannels) + " channels, the input has "
+                + to_string(channels));
+
+        SampleWriter writer(STDOUT_FILENO, stream.format, stream.fs, 1, stream.shmOut);
+        vector<Sample> frames(stream.blockSize * channels);
+        vector<Sample> signal(stream.blockSize), cutoffs(stream.blockSize), qs(stream.blockSize);
+
+        while ((n= stream.reader.read(frames.data(), frames.size()) / channels) > 0) {
+            for (size_t i= 0; i < n; ++i) {
+                const Sample *frame= frames.data() + i * channels;
+                signal[i]= frame[0];
+                cutoffs[i]= cutoffCv ? frame[1] : 0.0;
+                qs[i]= qCv ? frame[channels - 1] : 0.0;
+            }
+            filter.process(signal.data(), cutoffCv ? cutoffs.data() : nullptr, qCv ? qs.data() : nullptr, signal.data(), n);
+            writer.write(signal.data(), n);
+        }
+        return;
+    }
+
+    SampleWriter writer(STDOUT_FILENO, stream.format, stream.fs, channels, stream.shmOut);
+    vector<Sample> block(stream.blockSize * channels);
+
+    if (channels == 1) {
+        while ((n= stream.reader.read(block.data(), block.size())) > 0) {
+            filter.process(block.data(), block.data(), n);
+            writer.write(block.data(), n);
+        }
+    } else if (filter.narrow()) {
+        // interleaved channels are filtered independently, one per SIMD lane
+        vector<BasicBiquad<Sample>> sections;
+        for (const auto &bq : filter.sections())
+            sections.push_back(bq.template to<Sample>());
+
+        BasicBiquadBank<Sample> bank(sections, channels, stream.simd);
+        while ((n= stream.reader.read(block.data(), block.size())) > 0) {
+            bank.process(block.data(), block.data(), n / channels);
+            writer.write(block.data(), n);
+        }
+    } else {
+        // the same in double, which a float filter below its narrow range
+        // converts to and from
+        BiquadBank bank(filter.sections(), channels, stream.simd);
+        vector<double> wide(is_same_v<Sample, double> ? 0 : block.size());
+        while ((n= stream.reader.read(block.data(), block.size())) > 0) {
+            if constexpr (is_same_v<Sample, double>) {
+                bank.process(block.data(), block.data(), n / channels);
+            } else {
+                copy(block.begin(), block.begin() + n, wide.begin());
+                bank.process(wide.data(), wide.data(), n / channels);
+                copy(wide.begin(), wide.begin() + n, block.begin());
+            }
+            writer.write(block.data(), n);
+        }
+    }
+}
+
+// A double mono stream through the cascade specialized for its rolloff.
+static void run(Cascade &cascade, Stream &stream)
+{
+    SampleWriter writer(STDOUT_FILENO, stream.format, stream.fs, 1, stream.shmOut);
+    vector<double> block(stream.blockSize);
+    size_t n;
+
+    while ((n= stream.reader.read(block.data(), block.size())) > 0) {
+        cascade.process(block.data(), block.data(), n);
+        writer.write(block.data(), n);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args("Filter");
+    args.add_argument("--filter_type").default_value(string("lowpass")).help("lowpass | highpass").action([](const string &v){ return v; });
+    args.add_argument("--cutoff").required().help("cutoff frequency in Hz") .scan<'g',double>();
+    args.add_argument("--rolloff").default_value(12).help("rolloff in dB/oct (multiple of 6)").scan<'i', int>();
+    args.add_argument("--sample_rate").default_value(48000.0).help("sampling rate (Hz)").scan<'g', double>();
+    args.add_argument("--format").default_value(string("text")).help("text | raw | f32 | f64").action([](const string &v){ parseAudioFormat(v); return v; });
+    args.add_argument("--block_size").default_value(256).help("samples processed per block").scan<'i', int>();
+    args.add_argument("--shm_in").default_value(string("")).help("read from the shared-memory ring NAME instead of stdin");
+    args.add_argument("--shm_out").default_value(string("")).help("write to the shared-memory ring NAME instead of stdout");
+    args.add_argument("--simd").default_value(string("auto")).help("auto | scalar | sse2 | avx2 | avx512").action([](const string &v){ parseSimdLevel(v); return v; });
+    args.add_argument("--precision").default_value(string("full")).help("coefficient design: low | high | full").action([](const string &v){ parsePrecision(v); return v; });
+    args.add_argument("--sample_type").default_value(string("double")).help("double | float: the type of the processed blocks").action([](const string &v){ parseProcessingType(v); return v; });
+    args.add_argument("--cutoff_cv").default_value(false).implicit_value(true).help("the input's next channel shifts the cutoff, in octaves (1 V/oct)");
+    args.add_argument("--q_cv").default_value(false).implicit_value(true).help("the input's next channel sets the Q of every 2nd-order section");
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &e) {
+        cerr << e.what() << endl << args << endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto type= parseFilterType(args.get<string>("filter_type"));
+    const auto cutoff= args.get<double>("cutoff");
+    const auto rolloff_db= args.get<int>("rolloff");
+    const auto fs= args.get<double>("sample_rate");
+    const auto format= parseAudioFormat(args.get<string>("format"));
+    const auto blockSize= args.get<int>("block_size");
+    const auto simd= parseSimdLevel(args.get<string>("simd"));
+    const auto precision= parsePrecision(args.get<string>("precision"));
+    const bool cutoffCv= args.get<bool>("cutoff_cv");
+    const bool qCv= args.get<bool>("q_cv");
+    const auto sampleType= parseProcessingType(args.get<string>("sample_type"));
+    if (rolloff_db % 6 != 0) {
+        cerr << "rolloff must be an integer multiple of 6 dB" << endl;
+        return EXIT_FAILURE;
+    }
+    if (blockSize < 1) {
+        cerr << "block_size must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // modulated: frames of the signal, then the cutoff and Q voltages
+    const uint32_t modulatedChannels= 1 + cutoffCv + qCv;
+    SampleReader reader(STDIN_FILENO, format, args.get<string>("shm_in"), modulatedChannels);
+    Stream stream{ reader, format, fs, args.get<string>("shm_out"), static_cast<size_t>(blockSize), simd };
+
+    try {
+        if (sampleType == ProcessingType::FLOAT)
+            run(BasicFilter<float>(fs, type, cutoff, rolloff_db, simd, precision), stream, cutoffCv, qCv);
+        else if (modulatedChannels == 1 && reader.channels() == 1)
+            run(*makeFilterCascade(fs, type, cutoff, rolloff_db, simd, precision), stream);
+        else
+            run(Filter(fs, type, cutoff, rolloff_db, simd, precision), stream, cutoffCv, qCv);
+    } catch (const exception &err) {
+        cerr << err.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "pacer.hpp"
+#include "patch.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+// End-to-end throughput and latency of a module chain.
+//
+// pipebench generates a control-voltage ramp, feeds it block by block into
+// the chain and reads the result back. Every input block is stamped when it
+// is written; since each module emits exactly one sample per input sample,
+// the block's last sample index is its marker, and its latency is the time
+// until that many samples have come out. A chain ending in `scope
+// --null_render` produces no output, so only throughput and CPU are reported.
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+struct Stage {
+    string name;
+    vector<string> args;
+    double cpuSeconds= 0.0;
+};
+
+vector<Stage> parseChain(const string &chain) {
+    vector<Stage> stages;
+    istringstream iss(chain);
+    string text;
+
+    while (getline(iss, text, '|')) {
+        istringstream tokens(text);
+        Stage stage;
+        string token;
+
+        while (tokens >> token)
+            stage.args.push_back(token);
+
+        if (stage.args.empty())
+            throw runtime_error("empty stage in chain");
+
+        stage.name= stage.args.front();
+        stages.push_back(stage);
+    }
+
+    if (stages.empty())
+        throw runtime_error("empty chain");
+
+    return stages;
+}
+
+// the input ramp: one second from 1 to 2 V, repeated
+void fillInput(double *block, size_t n, size_t offset, double sampleRate) {
+    size_t period= static_cast<size_t>(sampleRate);
+    for (size_t i= 0; i < n; ++i)
+        block[i]= 1.0 + static_cast<double>((offset + i) % period) / period;
+}
+
+string selfDirectory() {
+    char path[4096];
+    ssize_t length= readlink("/proc/self/exe", path, sizeof(path) - 1);
+
+    if (length <= 0)
+        return ".";
+
+    string self(path, length);
+    return self.substr(0, self.rfind('/'));
+}
+
+double percentile(const vector<double> &sorted, double q) {
+    if (sorted.empty())
+        return 0.0;
+    return sorted[min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+}
+
+struct Run {
+    size_t samples= 0;
+    double seconds= 0.0;
+    vector<double> latencies;   // per block, seconds
+};
+
+pid_t spawn(const Stage &stage, const string &binDir, const string &format, int in, int out,
+    const string &shmIn, const string &shmOut) {
+    vector<string> args= stage.args;
+    args.front()= binDir + "/" + stage.name;
+    args.push_back("--format");
+    args.push_back(format);
+
+    if (!shmIn.empty())
+        args.insert(args.end(), { "--shm_in", shmIn });
+    if (!shmOut.empty())
+        args.insert(args.end(), { "--shm_out", shmOut });
+
+    pid_t pid= fork();
+    if (pid < 0)
+        throw runtime_error(string("fork: ") + strerror(errno));
+
+    if (pid == 0) {
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+
+        // drop every other pipe end so EOF propagates down the chain
+        for (int fd= 3; fd < 1024; ++fd)
+            close(fd);
+
+        vector<char *> argv;
+        for (auto &arg : args)
+            argv.push_back(arg.data());
+        argv.push_back(nullptr);
+
+        execv(argv[0], argv.data());
+        cerr << "pipebench: cannot run " << argv[0] << ": " << strerror(errno) << endl;
+        _exit(127);
+    }
+
+    return pid;
+}
+
+// With shm set, the stages are linked by shared-memory rings instead; the
+// pipes stay in place but carry nothing.
+Run runProcesses(vector<Stage> &stages, const string &binDir, Format format, const string &formatName,
+    bool shm, double sampleRate, size_t totalSamples, size_t blockSize, Pacer::Mode pacing) {
+
+    // pipe i feeds stage i; the last pipe carries the chain's output
+    vector<int> readEnds, writeEnds;
+    for (size_t i= 0; i <= stages.size(); ++i) {
+        int p[2];
+        if (pipe(p) < 0)
+            throw runtime_error(string("pipe: ") + strerror(errno));
+        readEnds.push_back(p[0]);
+        writeEnds.push_back(p[1]);
+    }
+
+    bool sink= (stages.back().name == "scope");
+    int devNull= open("/dev/null", O_WRONLY);
+    vector<pid_t> pids;
+
+    // ring i feeds stage i, like the pipes
+    vector<string> rings;
+    for (size_t i= 0; i <= stages.size(); ++i)
+        rings.push_back(shm ? "pipebench-" + to_string(getpid()) + "-" + to_string(i) : "");
+
+    for (size_t i= 0; i < stages.size(); ++i) {
+        bool last= (i + 1 == stages.size());
+        int out= (sink && last) ? devNull : writeEnds[i + 1];
+        pids.push_back(spawn(stages[i], binDir, formatName, readEnds[i], out, rings[i], (sink && last) ? "" : rings[i + 1]));
+    }
+
+    for (size_t i= 1; i <= stages.size(); ++i)
+        close(writeEnds[i]);
+    for (size_t i= 0; i < stages.size(); ++i)
+        close(readEnds[i]);
+    close(devNull);
+
+    size_t blocks= (totalSamples + blockSize - 1) / blockSize;
+    vector<atomic<int64_t>> stamps(blocks);
+    Run run;
+    auto start= Clock::now();
+
+    thread feeder([&]() {
+        try {
+            Pacer pacer(pacing, sampleRate);
+            SampleWriter writer(writeEnds[0], format, sampleRate, 1, rings.front());
+            vector<double> block(blockSize);
+
+            for (size_t b= 0; b < blocks; ++b) {
+                size_t n= min(blockSize, totalSamples - b * blockSize);
+                fillInput(block.data(), n, b * blockSize, sampleRate);
+                pacer.wait(n);
+
+                stamps[b].store(Clock::now().time_since_epoch().count(), memory_order_release);
+                writer.write(block.data(), n);
+                writer.flush();
+            }
+        } catch (const exception &e) {
+            cerr << "pipebench: feeding the chain: " << e.what() << endl;
+        }
+
+        close(writeEnds[0]);
+    });
+
+    if (!sink) {
+        SampleReader reader(readEnds[stages.size()], format, rings.back());
+        vector<double> block(blockSize);
+        size_t n, next= 0;
+
+        while ((n= reader.read(block.data(), block.size())) > 0) {
+            run.samples+= n;
+            int64_t now= Clock::now().time_since_epoch().count();
+
+            for (; next < blocks && run.samples >= min(totalSamples, (next + 1) * blockSize); ++next) {
+                int64_t stamp= stamps[next].load(memory_order_acquire);
+                run.latencies.push_back(chrono::duration<double>(Clock::duration(now - stamp)).count());
+            }
+        }
+        close(readEnds[stages.size()]);
+    } else {
+        run.samples= totalSamples;
+    }
+
+    feeder.join();
+
+    for (size_t i= 0; i < pids.size(); ++i) {
+        int status;
+        rusage usage;
+
+        if (wait4(pids[i], &status, 0, &usage) < 0)
+            throw runtime_error(string("wait4: ") + strerror(errno));
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            cerr << "pipebench: stage '" << stages[i].name << "' exited abnormally" << endl;
+
+        stages[i].cpuSeconds= usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+    }
+
+    run.seconds= chrono::duration<double>(Clock::now() - start).count();
+    return run;
+}
+
+// The same chain as in-process patches, one per stage so each can be timed.
+Run runInProcess(vector<Stage> &stages, double sampleRate, size_t totalSamples, size_t blockSize, Pacer::Mode pacing) {
+    vector<Patch> patches;
+    for (const auto &stage : stages) {
+        string text;
+        for (const auto &arg : stage.args)
+            text+= arg + " ";
+        patches.emplace_back(text);
+    }
+
+    if (patches.front().hasSource())
+        throw runtime_error("pipebench feeds the chain itself; drop the cv stage");
+
+    Pacer pacer(pacing, sampleRate);
+    vector<double> block(blockSize);
+    Run run;
+    auto start= Clock::now();
+
+    for (size_t offset= 0; offset < totalSamples; offset+= blockSize) {
+        size_t n= min(blockSize, totalSamples - offset);
+        fillInput(block.data(), n, offset, sampleRate);
+        pacer.wait(n);
+
+        auto blockStart= Clock::now();
+        for (size_t s= 0; s < patches.size(); ++s) {
+            auto stageStart= Clock::now();
+            patches[s].process(block.data(), n);
+            stages[s].cpuSeconds+= chrono::duration<double>(Clock::now() - stageStart).count();
+        }
+
+        run.latencies.push_back(chrono::duration<double>(Clock::now() - blockStart).count());
+        run.samples+= n;
+    }
+
+    run.seconds= chrono::duration<double>(Clock::now() - start).count();
+    return run;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args("pipebench");
+    args.add_argument("--chain").default_value(string("vco --sensitivity 100 --wave_type square | filter --cutoff 3000 | filter --filter_type highpass --cutoff 1000"))
+        .help("chain to measure, without the cv source");
+    args.add_argument("--duration").default_value(10.0).help("seconds of audio to push through").scan<'g', double>();
+    args.add_argument("--sample_rate").default_value(48000.0).help("sampling rate (Hz)").scan<'g', double>();
+    args.add_argument("--block_size").default_value(256).help("samples per input block (the latency unit)").scan<'i', int>();
+    args.add_argument("--format").default_value(string("f64")).help("text | raw | f32 | f64").action([](const string &v){ parseAudioFormat(v); return v; });
+    args.add_argument("--transport").default_value(string("pipe")).help("pipe | shm: how the stage processes are linked").action([](const string &v){
+        if (v != "pipe" && v != "shm")
+            throw runtime_error("transport must be 'pipe' or 'shm'");
+        return v;
+    });
+    args.add_argument("--in_process").default_value(false).implicit_value(true).help("run the chain as in-process patches instead of processes");
+    args.add_argument("--bin_dir").default_value(selfDirectory()).help("directory holding the module binaries");
+    args.add_argument("--realtime").default_value(false).implicit_value(true).help("feed input at the sample rate (latency under real-time load)");
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &e) {
+        cerr << e.what() << endl << args << endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto sampleRate= args.get<double>("sample_rate");
+    const auto blockSize= args.get<int>("block_size");
+    const auto formatName= args.get<string>("format");
+    const auto inProcess= args.get<bool>("in_process");
+    const auto shm= args.get<string>("transport") == "shm";
+    const auto pacing= args.get<bool>("realtime") ? Pacer::Mode::REALTIME : Pacer::Mode::OFFLINE;
+    const auto totalSamples= static_cast<size_t>(args.get<double>("duration") * sampleRate);
+
+    if (blockSize < 1) {
+        cerr << "block_size must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // a stage that dies must not take the harness with it
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        vector<Stage> stages= parseChain(args.get<string>("chain"));
+        Run run= inProcess
+            ? runInProcess(stages, sampleRate, totalSamples, blockSize, pacing)
+            : runProcesses(stages, args.get<string>("bin_dir"), parseAudioFormat(formatName), formatName, shm, sampleRate,
+                totalSamples, blockSize, pacing);
+
+        sort(run.latencies.begin(), run.latencies.end());
+
+        printf("chain:      %zu stages, %s\n", stages.size(), inProcess ? "in-process" : (shm ? string("processes, shm") : "processes, " + formatName).c_str());
+        printf("throughput: %zu samples in %.3f s = %.4g samples/s (%.1fx real time)\n", run.samples, run.seconds,
+            run.samples / run.seconds, run.samples / run.seconds / sampleRate);
+
+        if (!run.latencies.empty())
+            printf("latency:    %d-sample blocks, p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n", blockSize,
+                percentile(run.latencies, 0.5) * 1e6, percentile(run.latencies, 0.99) * 1e6,
+                percentile(run.latencies, 0.999) * 1e6, run.latencies.back() * 1e6);
+
+        printf("cpu:\n");
+        for (const auto &stage : stages)
+            printf("  %-10s %9.3f s  %8.2f ns/sample\n", stage.name.c_str(), stage.cpuSeconds,
+                run.samples ? stage.cpuSeconds * 1e9 / run.samples : 0.0);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
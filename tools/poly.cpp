@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+#include <argparse/argparse.hpp>
+
+#include "filter.hpp"
+#include "poly.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args("poly");
+    args.add_argument("--voices").default_value(64).help("number of voices").scan<'i', int>();
+    args.add_argument("--lanes").default_value(0).help("(cv, gate) pairs per input frame; 0 takes them from the stream header").scan<'i', int>();
+    args.add_argument("--sensitivity").default_value(1.0).help("control voltage sensitivity").scan<'g', double>();
+    args.add_argument("--amplitude").default_value(1.0).help("amplitude of each voice").scan<'g', double>();
+    args.add_argument("--wave_type").default_value(string("sine")).help("sine, triangle, square").action([](const string &v){ parseWaveType(v); return v; });
+    args.add_argument("--attack").default_value(0.01f).help("attack").scan<'g', float>();
+    args.add_argument("--decay").default_value(0.1f).help("decay").scan<'g', float>();
+    args.add_argument("--sustain").default_value(0.7f).help("sustain").scan<'g', float>();
+    args.add_argument("--release").default_value(0.3f).help("release").scan<'g', float>();
+    args.add_argument("--filter_type").default_value(string("lowpass")).help("lowpass | highpass").action([](const string &v){ parseFilterType(v); return v; });
+    args.add_argument("--cutoff").default_value(0.0).help("per-voice filter cutoff in Hz; 0 disables the filter").scan<'g', double>();
+    args.add_argument("--rolloff").default_value(12).help("rolloff in dB/oct (multiple of 6)").scan<'i', int>();
+    args.add_argument("--sample_rate").default_value(48000.0).help("sampling rate (Hz)").scan<'g', double>();
+    args.add_argument("--format").default_value(string("text")).help("text | raw | f32 | f64").action([](const string &v){ parseAudioFormat(v); return v; });
+    args.add_argument("--block_size").default_value(256).help("frames processed per block").scan<'i', int>();
+    args.add_argument("--shm_in").default_value(string("")).help("read from the shared-memory ring NAME instead of stdin");
+    args.add_argument("--shm_out").default_value(string("")).help("write to the shared-memory ring NAME instead of stdout");
+    args.add_argument("--simd").default_value(string("auto")).help("auto | scalar | sse2 | avx2 | avx512").action([](const string &v){ parseSimdLevel(v); return v; });
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &e) {
+        cerr << e.what() << endl << args << endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto voices= args.get<int>("voices");
+    const auto fs= args.get<double>("sample_rate");
+    const auto cutoff= args.get<double>("cutoff");
+    const auto rolloff_db= args.get<int>("rolloff");
+    const auto format= parseAudioFormat(args.get<string>("format"));
+    const auto blockSize= args.get<int>("block_size");
+    const auto simd= parseSimdLevel(args.get<string>("simd"));
+    int lanes= args.get<int>("lanes");
+
+    if (voices < 1) {
+        cerr << "voices must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+    if (rolloff_db % 6 != 0) {
+        cerr << "rolloff must be an integer multiple of 6 dB" << endl;
+        return EXIT_FAILURE;
+    }
+    if (blockSize < 1) {
+        cerr << "block_size must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Poly poly(fs, voices, args.get<double>("sensitivity"), args.get<double>("amplitude"),
+            parseWaveType(args.get<string>("wave_type")), args.get<float>("attack"), args.get<float>("decay"),
+            args.get<float>("sustain"), args.get<float>("release"), simd);
+
+        if (cutoff > 0.0)
+            poly.setFilter(Filter(fs, parseFilterType(args.get<string>("filter_type")), cutoff, rolloff_db, simd).sections());
+
+        SampleReader reader(STDIN_FILENO, format, args.get<string>("shm_in"));
+
+        if (lanes == 0)
+            lanes= max<int>(1, reader.channels() / 2);
+        if (lanes < 1)
+            throw runtime_error("lanes must be at least 1");
+
+        const size_t stride= 2 * lanes;
+        SampleWriter writer(STDOUT_FILENO, format, fs, 1, args.get<string>("shm_out"));
+        vector<double> block(blockSize * stride);
+        vector<double> out(blockSize);
+        size_t pending= 0;
+        size_t n;
+
+        // text and raw streams may split a frame across reads
+        while ((n= reader.read(block.data() + pending, block.size() - pending)) > 0) {
+            pending+= n;
+            size_t frames= pending / stride;
+
+            poly.process(block.data(), lanes, out.data(), frames);
+            writer.write(out.data(), frames);
+
+            pending-= frames * stride;
+            copy(block.begin() + frames * stride, block.begin() + frames * stride + pending, block.begin());
+        }
+    } catch (const exception &err) {
+        cerr << err.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,697 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <csignal>
+#include <atomic>
+#include <memory>
+#include <sys/select.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <argparse/argparse.hpp>
+#include <SDL2/SDL.h>
+
+#include "envelope.hpp"
+#include "framewriter.hpp"
+#include "rasterizer.hpp"
+#include "ringbuffer.hpp"
+#include "spectrum.hpp"
+#include "trigger.hpp"
+#include "triplebuffer.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+atomic<bool> quit { false };
+
+// trace colors, repeated when there are more channels
+const vector<uint32_t> defaultColors= { 0x00FF00, 0xFF00FF, 0x00FFFF, 0xFF8000, 0xFFFFFF, 0x8080FF, 0xFF6060, 0xC0FF40 };
+
+vector<uint32_t> parseColors(const string &s) {
+    vector<uint32_t> colors;
+    stringstream list(s);
+    string color;
+
+    while (getline(list, color, ',')) {
+        if (color.size() != 6 || color.find_first_not_of("0123456789abcdefABCDEF") != string::npos)
+            throw runtime_error("colors must be comma-separated RRGGBB hex values");
+        colors.push_back(stoul(color, nullptr, 16));
+    }
+
+    if (colors.empty())
+        throw runtime_error("colors must be comma-separated RRGGBB hex values");
+
+    return colors;
+}
+
+void signal_handler(int signum) {
+
+    quit= true;
+    cerr << "receive signal: " << signum << '\n'; 
+}
+
+int main(int argc, char *argv[]) {
+
+    argparse::ArgumentParser args("Scope");
+    args.add_argument("--sample_rate").default_value(48000).help("sample rate (e.g, 48000 == 48KHz").scan<'i', int>();
+    args.add_argument("--trigger").default_value(false).implicit_value(true).help("enable trigger mode");
+    args.add_argument("--trigger_threshold").default_value(0.01f).help("trigger threshold").scan<'g', float>();
+    args.add_argument("--trigger_offset").default_value(0).help("trigger offset").scan<'i', int>();
+    args.add_argument("--trigger_edge").default_value(string("rising")).help("rising, falling, both").action([](const string &v){ parseTriggerEdge(v); return v; });
+    args.add_argument("--trigger_mode").default_value(string("normal")).help("auto (free-run without triggers), normal, single (space re-arms)").action([](const string &v){ parseTriggerMode(v); return v; });
+    args.add_argument("--hysteresis").default_value(0.0f).help("trigger hysteresis in volts").scan<'g', float>();
+    args.add_argument("--holdoff").default_value(0.0f).help("seconds after a trigger during which crossings are ignored").scan<'g', float>();
+    args.add_argument("--pre_trigger").default_value(0.0f).help("fraction of the display before the trigger point (0-1)").scan<'g', float>();
+    args.add_argument("--window_width").default_value(800).help("window width").scan<'i', int>();
+    args.add_argument("--window_height").default_value(400).help("window height").scan<'i', int>();
+    args.add_argument("--voltage_per_division").default_value(0.1f).help("vols per division (e.g, 0.1 == 1v)").scan<'g', float>();
+    args.add_argument("--time_per_division").default_value(0.001f).help("time per division in seconds (e.g, 0.001 == 1ms)").scan<'g', float>();
+    args.add_argument("--time_divisions").default_value(10).help("total time divisions to display (e.g, 10)").scan<'i', int>();
+    args.add_argument("--voltage_divisions").default_value(10).help("total voltage divisions to display (e.g, 10)").scan<'i', int>();
+    args.add_argument("--format").default_value(string("text")).help("input format: text, raw, f32, f64").action([](const string &value) {
+        parseFormat(value);
+        return value;
+    });
+    args.add_argument("--channels").default_value(1).help("interleaved channels in text (one column each) and raw input; binary streams carry their own").scan<'i', int>();
+    args.add_argument("--trigger_channel").default_value(0).help("channel the trigger watches, from 0").scan<'i', int>();
+    args.add_argument("--colors").default_value(string("")).help("comma-separated RRGGBB trace colors, one per channel").action([](const string &v){ if (!v.empty()) parseColors(v); return v; });
+    args.add_argument("--rms").default_value(false).implicit_value(true).help("draw the RMS band inside the min/max envelope");
+    args.add_argument("--shm_in").default_value(string("")).help("read from the shared-memory ring NAME instead of stdin");
+    args.add_argument("--spectrum").default_value(false).implicit_value(true).help("show each channel's spectrum on log-frequency/dB axes instead of the waveform");
+    args.add_argument("--fft_size").default_value(8192).help("spectrum: samples per FFT frame, a power of two").scan<'i', int>();
+    args.add_argument("--window").default_value(string("hann")).help("spectrum window: rectangular, hann, hamming, blackman_harris, flat_top").action([](const string &v){ parseWindow(v); return v; });
+    args.add_argument("--overlap").default_value(0.5f).help("spectrum: fraction shared by successive FFT frames (0-0.95)").scan<'g', float>();
+    args.add_argument("--averaging").default_value(string("exponential")).help("spectrum averaging: none, exponential, peak (hold)").action([](const string &v){ parseAveraging(v); return v; });
+    args.add_argument("--smoothing").default_value(0.8f).help("spectrum: weight of the previous spectrum in exponential averaging").scan<'g', float>();
+    args.add_argument("--min_frequency").default_value(20.0f).help("spectrum: lowest frequency shown, in Hz").scan<'g', float>();
+    args.add_argument("--db_range").default_value(120.0f).help("spectrum: dB shown below 0 dB (a unit-amplitude sine)").scan<'g', float>();
+    args.add_argument("--headless").default_value(false).implicit_value(true).help("no window: render frames as fast as the input allows and write them to --output");
+    args.add_argument("--output").default_value(string("-")).help("headless output file, '-' for stdout, or a pattern like frame_%05d.png for one file per frame");
+    args.add_argument("--output_format").default_value(string("ppm")).help("headless frame format: ppm, png, rgba").action([](const string &v){ parseFrameType(v); return v; });
+    args.add_argument("--frame_interval").default_value(0.016f).help("headless: seconds of input between frames; 0 renders every trigger").scan<'g', float>();
+    args.add_argument("--null_render").default_value(false).implicit_value(true).help("draw frames off-screen without opening a window (for benchmarks)");
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &err) {
+        cerr << err.what() << endl << args;
+        return EXIT_FAILURE;;
+    }
+
+    int windowWidth= args.get<int>("window_width");
+    int windowHeight= args.get<int>("window_height");
+    int sampleRate= args.get<int>("sample_rate");
+    float timePerDivision= args.get<float>("time_per_division");
+    float voltagePerDivision= args.get<float>("voltage_per_division");
+    int timeDivisions= args.get<int>("time_divisions");
+    int voltageDivisions= args.get<int>("voltage_divisions");
+    bool trigger= args.get<bool>("trigger");
+    float triggerThreshold= args.get<float>("trigger_threshold");
+    int triggerOffset= args.get<int>("trigger_offset");
+    Trigger::Edge triggerEdge= parseTriggerEdge(args.get<string>("trigger_edge"));
+    Trigger::Mode triggerMode= parseTriggerMode(args.get<string>("trigger_mode"));
+    float hysteresis= args.get<float>("hysteresis");
+    float holdoff= args.get<float>("holdoff");
+    float preTrigger= clamp(args.get<float>("pre_trigger"), 0.0f, 1.0f);
+    Format format= parseFormat(args.get<string>("format"));
+    string shmIn= args.get<string>("shm_in");
+    bool nullRender= args.get<bool>("null_render");
+    bool drawRms= args.get<bool>("rms");
+    bool headless= args.get<bool>("headless");
+    float headlessInterval= args.get<float>("frame_interval");
+    int triggerChannel= args.get<int>("trigger_channel");
+    vector<uint32_t> colors= args.get<string>("colors").empty() ? defaultColors : parseColors(args.get<string>("colors"));
+    bool spectrumMode= args.get<bool>("spectrum");
+    float overlap= clamp(args.get<float>("overlap"), 0.0f, 0.95f);
+    float minFrequency= args.get<float>("min_frequency");
+    float maxFrequency= sampleRate / 2.0f;
+    float dbRange= args.get<float>("db_range");
+
+    float totalTime= timePerDivision * timeDivisions;  
+    float voltageFullScale= voltagePerDivision * voltageDivisions;
+    float voltageHalfScale= voltageFullScale / 2.0f;
+    size_t displayBufferSize= static_cast<size_t>(sampleRate * totalTime);
+    int ringBufferSize= displayBufferSize * 4;
+
+    if (args.get<int>("channels") < 1) {
+        cerr << "channels must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // set non-blocking mode; headless just blocks on its input
+    if (!headless) {
+        int flags= fcntl(STDIN_FILENO, F_GETFL, 0);
+        fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    // a binary stream's header decides the channel count, so it is read
+    // before anything is sized
+    unique_ptr<SampleReader> reader;
+    size_t channels;
+    try {
+        reader= make_unique<SampleReader>(STDIN_FILENO, format, shmIn, args.get<int>("channels"));
+        channels= reader->channels();
+    } catch (const exception &err) {
+        cerr << err.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (triggerChannel < 0 || static_cast<size_t>(triggerChannel) >= channels) {
+        cerr << "trigger_channel must be below the stream's " << channels << " channels" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // one ring per channel, all advanced together
+    vector<unique_ptr<RingBuffer<float>>> rings;
+    for (size_t c= 0; c < channels; ++c)
+        rings.push_back(make_unique<RingBuffer<float>>(ringBufferSize));
+
+    // spectrum mode: the input thread queues samples for the analysis
+    // worker, which slides a window of fftSize along each channel by hop
+    // samples and publishes every channel's dB levels at once
+    vector<Spectrum> analyzers;
+    vector<vector<float>> analysisWindows;
+    vector<unique_ptr<RingBuffer<float>>> analysisRings;
+    size_t fftSize= 0;
+    size_t bins= 0;
+    size_t hop= 0;
+
+    if (spectrumMode) {
+        if (minFrequency <= 0.0f || minFrequency >= maxFrequency || dbRange <= 0.0f) {
+            cerr << "min_frequency must be between 0 and half the sample rate, and db_range positive" << endl;
+            return EXIT_FAILURE;
+        }
+
+        try {
+            for (size_t c= 0; c < channels; ++c)
+                analyzers.emplace_back(args.get<int>("fft_size"), parseWindow(args.get<string>("window")),
+                    parseAveraging(args.get<string>("averaging")), args.get<float>("smoothing"));
+        } catch (const exception &err) {
+            cerr << err.what() << endl;
+            return EXIT_FAILURE;
+        }
+
+        fftSize= analyzers[0].size();
+        bins= analyzers[0].bins();
+        hop= max<size_t>(fftSize * (1.0f - overlap), 1);
+        analysisWindows.assign(channels, vector<float>(fftSize, 0.0f));
+        for (size_t c= 0; c < channels; ++c)
+            analysisRings.push_back(make_unique<RingBuffer<float>>(fftSize * 4));
+    }
+
+    TripleBuffer<vector<float>> spectra(vector<float>(channels * bins, -300.0f));
+
+    // the trigger point sits preSamples from the left edge
+    size_t preSamples= min(static_cast<size_t>(preTrigger * displayBufferSize) + max(triggerOffset, 0), displayBufferSize);
+    size_t postSamples= displayBufferSize - preSamples;
+    atomic<bool> rearm { false };
+    const auto frameInterval= chrono::milliseconds(16);
+
+    // the producer publishes at most one frame per render interval and
+    // never waits for the renderer; a frame holds each channel in turn
+    TripleBuffer<vector<float>> frames(vector<float>(displayBufferSize * channels, 0.0f));
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    SDL_Window* window= nullptr;
+    SDL_Renderer* renderer= nullptr;
+    SDL_Texture* waveformTexture= nullptr;
+    unique_ptr<FrameWriter> frameWriter;
+
+    if (headless) {
+        try {
+            frameWriter= make_unique<FrameWriter>(args.get<string>("output"), parseFrameType(args.get<string>("output_format")), windowWidth, windowHeight);
+        } catch (const exception &err) {
+            cerr << err.what() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!nullRender && !headless) {
+        SDL_Init(SDL_INIT_VIDEO);
+
+        window= SDL_CreateWindow(
+            "Triggered Scope",
+             SDL_WINDOWPOS_CENTERED,
+             SDL_WINDOWPOS_CENTERED,
+             windowWidth,
+             windowHeight,
+             SDL_WINDOW_SHOWN
+        );
+
+        renderer= SDL_CreateRenderer(
+            window, 
+            -1,
+             SDL_RENDERER_ACCELERATED
+        );
+
+        waveformTexture= SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_RGB888,
+            SDL_TEXTUREACCESS_STREAMING,
+            windowWidth,
+            windowHeight
+        );
+    }
+
+
+    // the frame's envelopes are rebuilt only when the producer replaces it;
+    // zooming (+/-) re-reads the pyramids, never the frame
+    vector<Envelope> envelopes(channels);
+    vector<Envelope::Column> columns(windowWidth);
+    Rasterizer rasterizer(windowWidth, windowHeight);
+    size_t zoom= 1;
+    for (size_t c= 0; c < channels; ++c)
+        envelopes[c].set(frames.front().data() + c * displayBufferSize, displayBufferSize);
+
+    // draws the graticule, axes and trigger indicator into a cleared
+    // window-sized layer
+    auto drawGraticule= [&](uint32_t *pixels) {
+        uint32_t pitchFactor= windowWidth;
+
+        if (spectrumMode) {
+            // a column at 1, 2 and 5 of every decade, a row every 10 dB
+            for (double decade= 1.0; decade < maxFrequency; decade*= 10.0) {
+                for (double f : { decade, 2.0 * decade, 5.0 * decade }) {
+                    int x= log(f / minFrequency) / log(maxFrequency / minFrequency) * windowWidth;
+                    if (f > minFrequency && f < maxFrequency && x < windowWidth) {
+                        for(int y= 0; y < windowHeight; ++y)
+                            pixels[y * pitchFactor + x]= 0x222222;
+                    }
+                }
+            }
+
+            for (float db= 0.0f; db <= dbRange; db+= 10.0f) {
+                int y= min(static_cast<int>(db / dbRange * windowHeight), windowHeight - 1);
+                fill(pixels + y * pitchFactor, pixels + y * pitchFactor + windowWidth, 0x222222);
+            }
+            return;
+        }
+
+        // time divisions
+        for(int i=1; i <= timeDivisions; ++i) {
+            int x= min(i * windowWidth / timeDivisions, windowWidth - 1);
+            for(int y= 0; y < windowHeight; ++y)
+                pixels[y * pitchFactor + x]= 0x222222;
+            }
+
+        // voltage divisions (y-axis)
+        for(int i= 0; i <= voltageDivisions; ++i) {
+            int y= min(i * (windowHeight / voltageDivisions), windowHeight - 1);
+            for(int x= 0; x < windowWidth; ++x) 
+                pixels[y * pitchFactor + x]= (i == voltageDivisions / 2) ? 0x444444: 0x222222;
+        }
+
+        // x-axis
+        int yAxis= static_cast<int>(windowHeight / 2);
+        for(int x=0; x < windowWidth; ++x) {
+            pixels[yAxis * pitchFactor + x]= 0x0000FF;
+        } 
+
+        // trigger indicator
+        if (trigger) {
+            size_t visibleSamples= max<size_t>(displayBufferSize / zoom, 1);
+            float yCenter= windowHeight / 2.0f;
+
+            int thresholdY = static_cast<int>(yCenter - (triggerThreshold / voltageHalfScale) * yCenter);
+            if (thresholdY >= 0 && thresholdY < windowHeight) {
+                for (int x = 0; x < windowWidth; ++x) {
+                    pixels[thresholdY * pitchFactor + x] = 0xFFFF00; // Yellow line
+                }
+            }
+
+            int markerX = (float)preSamples / visibleSamples * windowWidth;
+            if (markerX >= 0 && markerX < windowWidth) {
+                for (int y = 0; y < windowHeight; ++y) {
+                    pixels[y * pitchFactor + markerX] = 0xFF0000; 
+                }
+            }
+        }
+    };
+
+    // Static background. Only the zoom changes it (the trigger marker
+    // moves), so it is drawn once per zoom level. Most of its rows are
+    // alike and only the distinct ones are kept, a few rows that stay in
+    // cache while traces are drawn over them.
+    vector<uint32_t> backgroundRows;
+    vector<const uint32_t *> background(windowHeight);    // row y's pixels
+
+    auto drawBackground= [&]() {
+        vector<uint32_t> layer(static_cast<size_t>(windowWidth) * windowHeight, 0);
+        vector<size_t> offsets(windowHeight);
+        size_t bytes= windowWidth * sizeof(uint32_t);
+        drawGraticule(layer.data());
+
+        // alike rows are mostly neighbours, so try the previous one first
+        backgroundRows.clear();
+        for (int y= 0; y < windowHeight; ++y) {
+            const uint32_t *row= layer.data() + static_cast<size_t>(y) * windowWidth;
+            optional<size_t> match;
+
+            if (y > 0 && memcmp(backgroundRows.data() + offsets[y - 1], row, bytes) == 0)
+                match= offsets[y - 1];
+            for (size_t offset= 0; !match && offset < backgroundRows.size(); offset+= windowWidth) {
+                if (memcmp(backgroundRows.data() + offset, row, bytes) == 0)
+                    match= offset;
+            }
+
+            if (!match) {
+                match= backgroundRows.size();
+                backgroundRows.insert(backgroundRows.end(), row, row + windowWidth);
+            }
+            offsets[y]= *match;
+        }
+
+        for (int y= 0; y < windowHeight; ++y)
+            background[y]= backgroundRows.data() + offsets[y];
+    };
+
+    // Composite of the background and the traces, kept between frames so
+    // only the rows the old or the new traces touch are redrawn
+    vector<uint32_t> canvas(static_cast<size_t>(windowWidth) * windowHeight);
+    bool redrawAll= true;
+
+    // zoom the trace layers were built for, 0 before the first frame
+    size_t tracedZoom= 0;
+
+    // Rebuilds the trace layers when a new frame was published or the zoom
+    // changed (redrawing the background too in that case); returns false,
+    // doing nothing, when neither happened since the last call.
+    auto updateLayers= [&]() {
+        bool fresh= spectrumMode ? spectra.update() : frames.update();
+
+        if (fresh && !spectrumMode) {
+            for (size_t c= 0; c < channels; ++c)
+                envelopes[c].set(frames.front().data() + c * displayBufferSize, displayBufferSize);
+        }
+
+        if (!fresh && zoom == tracedZoom)
+            return false;
+
+        if (zoom != tracedZoom) {
+            drawBackground();
+            redrawAll= true;
+        }
+        tracedZoom= zoom;
+
+        rasterizer.clear();
+
+        if (spectrumMode) {
+            // spectra: 0 dB at the top, -dbRange at the bottom
+            for (size_t c= 0; c < channels; ++c) {
+                spectrumColumns(spectra.front().data() + c * bins, bins, static_cast<double>(sampleRate) / fftSize,
+                    minFrequency, maxFrequency, columns.data(), windowWidth);
+                for (auto &column : columns) {
+                    column.min+= dbRange / 2.0f;
+                    column.max+= dbRange / 2.0f;
+                }
+                rasterizer.addTrace(columns.data(), dbRange / 2.0f, colors[c % colors.size()], false);
+            }
+        } else {
+            // waveforms: the min/max envelope of the samples under each column
+            size_t visibleSamples= max<size_t>(displayBufferSize / zoom, 1);
+            for (size_t c= 0; c < channels; ++c) {
+                envelopes[c].columns(0, visibleSamples, columns.data(), windowWidth);
+                rasterizer.addTrace(columns.data(), voltageHalfScale, colors[c % colors.size()], drawRms);
+            }
+        }
+        return true;
+    };
+
+    // Brings the canvas up to date with the layers and returns the rows
+    // that changed, first > last when none did. After a background change
+    // every row is composed afresh: the cached background row with every
+    // trace laid over it. Otherwise only the rows the old or the new traces
+    // touch are, or, when the traces cover little of those rows (a thin
+    // waveform at a high resolution), just the pixels under them.
+    auto drawFrame= [&]() {
+        int first= redrawAll ? 0 : rasterizer.firstRow();
+        int last= redrawAll ? windowHeight - 1 : rasterizer.lastRow();
+        size_t rowPixels= static_cast<size_t>(max(last - first + 1, 0)) * windowWidth;
+
+        // each pixel written down a column is a cache line of its own;
+        // below an eighth of the rows' pixels that still beats composing them
+        if (!redrawAll && rasterizer.coverage() * 8 < rowPixels) {
+            rasterizer.updateColumns(canvas.data(), background.data());
+        } else {
+            for (int y= first; y <= last; ++y) {
+                uint32_t *row= canvas.data() + static_cast<size_t>(y) * windowWidth;
+                memcpy(row, background[y], windowWidth * sizeof(uint32_t));
+                rasterizer.drawRow(y, row);
+            }
+        }
+
+        redrawAll= false;
+        return pair<int, int>(first, last);
+    };
+
+    // analysis worker: slides every channel's window along by hop samples
+    // as long as all of them have that many queued; returns whether it
+    // published new spectra
+    auto analyze= [&]() {
+        bool published= false;
+
+        while (true) {
+            size_t ready= analysisRings[0]->size();
+            for (size_t c= 1; c < channels; ++c)
+                ready= min(ready, analysisRings[c]->size());
+            if (ready < hop)
+                break;
+
+            for (size_t c= 0; c < channels; ++c) {
+                float *window= analysisWindows[c].data();
+                memmove(window, window + hop, (fftSize - hop) * sizeof(float));
+                analysisRings[c]->popBlock(window + fftSize - hop, hop);
+                analyzers[c].process(window);
+            }
+            published= true;
+        }
+
+        if (published) {
+            for (size_t c= 0; c < channels; ++c)
+                copy(analyzers[c].decibels().begin(), analyzers[c].decibels().end(), spectra.back().begin() + c * bins);
+            spectra.publish();
+        }
+
+        return published;
+    };
+
+    // headless: draws the newest frame and writes it out
+    auto writeFrame= [&]() {
+        updateLayers();
+        drawFrame();
+        try {
+            frameWriter->write(canvas.data(), windowWidth);
+        } catch (const exception &err) {
+            cerr << err.what() << endl;
+            quit= true;
+        }
+    };
+
+    // producer: runs on its own thread, or on the main thread when headless
+    auto produce= [&]() {
+
+        const size_t blockFrames= 256;
+        vector<double> samples(blockFrames * channels);
+        vector<float> block(samples.size());    // one run of blockFrames per channel
+        size_t samplesRead;
+        auto lastPublish= chrono::steady_clock::now() - frameInterval;
+        uint64_t headlessSamples= static_cast<uint64_t>(headlessInterval * sampleRate);
+        optional<uint64_t> lastPublishPosition;
+        uint64_t received= 0;
+
+        Trigger detector(triggerThreshold, hysteresis, triggerEdge, static_cast<uint64_t>(holdoff * sampleRate), displayBufferSize);
+        // auto mode free-runs when nothing triggered for a display width plus 100 ms
+        uint64_t autoSamples= displayBufferSize + sampleRate / 10;
+        optional<uint64_t> shown;
+        uint64_t armedFrom= 0;
+        bool held= false;
+
+        // nothing consumes the ring; when full, the oldest samples are dropped
+        auto pushDropping= [&](RingBuffer<float> &ring, const float *src, size_t n) {
+            size_t free= ring.capacity() - ring.size();
+            if (n > free)
+                ring.commitRead(n - free);
+            ring.pushBlock(src, n);
+        };
+
+        while (!quit) {
+
+            try {
+                samplesRead= reader->read(samples.data(), samples.size());
+            } catch (const exception &err) {
+                cerr << err.what() << endl;
+                quit= true;
+                break;
+            }
+
+            if(samplesRead > 0) {
+
+                // reads hold whole frames
+                size_t framesRead= samplesRead / channels;
+                for (size_t c= 0; c < channels; ++c) {
+                    float *channel= block.data() + c * blockFrames;
+                    for(size_t s= 0; s < framesRead; ++s)
+                        channel[s]= static_cast<float>(samples[s * channels + c]);
+
+                    // a worker that falls behind loses the newest samples
+                    if (spectrumMode)
+                        analysisRings[c]->pushBlock(channel, framesRead);
+                    else
+                        pushDropping(*rings[c], channel, framesRead);
+                }
+                received+= framesRead;
+
+                if (spectrumMode) {
+                    if (headless && analyze() && (!lastPublishPosition || received - *lastPublishPosition >= headlessSamples)) {
+                        lastPublishPosition= received;
+                        writeFrame();
+                    }
+                    continue;
+                }
+
+                detector.process(block.data() + triggerChannel * blockFrames, framesRead);
+
+                // headless frames are spaced in input time, not wall-clock time
+                auto now= chrono::steady_clock::now();
+                uint64_t position= detector.position();
+                if (headless ? (lastPublishPosition && position - *lastPublishPosition < headlessSamples) : now - lastPublish < frameInterval)
+                    continue;
+
+                // samples between the newest one and the frame's end
+                optional<size_t> offsetFromHead;
+
+                if (!trigger) {
+                    offsetFromHead= triggerOffset;
+                } else {
+                    if (rearm.exchange(false)) {
+                        armedFrom= position;
+                        held= false;
+                    }
+
+                    // the newest trigger with a whole frame after it
+                    auto triggered= (position >= postSamples) ? detector.latest(position - postSamples) : nullopt;
+                    auto newest= detector.latest(position);
+
+                    if (triggered && *triggered >= armedFrom && *triggered >= preSamples && triggered != shown && !held) {
+                        offsetFromHead= position - (*triggered + postSamples);
+                        shown= triggered;
+                        held= (triggerMode == Trigger::Mode::SINGLE);
+                    } else if (triggerMode == Trigger::Mode::AUTO && (!newest || position - *newest > autoSamples)) {
+                        offsetFromHead= 0;
+                    }
+                }
+
+                if (offsetFromHead && rings[0]->size() >= *offsetFromHead + displayBufferSize) {
+                    for (size_t c= 0; c < channels; ++c)
+                        rings[c]->copyFromTail(*offsetFromHead, frames.back().data() + c * displayBufferSize, displayBufferSize);
+                    frames.publish();
+                    lastPublish= now;
+                    lastPublishPosition= position;
+
+                    if (headless)
+                        writeFrame();
+                }
+            } else if (reader->eof()) {
+               // no more data
+               quit= true;
+            } else {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            } // end if samplesRead
+
+        } // end while !quit
+        cerr << "quiting thread\n";
+    };
+
+    if (headless) {
+        produce();
+        cerr << "scope: wrote " << frameWriter->frames() << " frames" << endl;
+        return EXIT_SUCCESS;
+    }
+
+    thread inputThread(produce);
+
+    // the FFTs stay off the render loop
+    thread analysisThread;
+    if (spectrumMode) {
+        analysisThread= thread([&]() {
+            while (!quit) {
+                if (!analyze())
+                    this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        });
+    }
+
+    // consumer / render loop
+    SDL_Event event;
+    auto lastDrawTime= chrono::steady_clock::now();
+    bool exposed= false;
+
+    while (!quit) {
+        while (!nullRender && SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) 
+                quit= true;
+
+            // the texture still holds the last frame, it only needs presenting
+            if (event.type == SDL_WINDOWEVENT)
+                exposed= true;
+
+            if (event.type == SDL_KEYDOWN) {
+                int key= event.key.keysym.sym;
+                if (key == SDLK_SPACE)
+                    rearm= true;
+                if ((key == SDLK_PLUS || key == SDLK_EQUALS || key == SDLK_KP_PLUS) && displayBufferSize / (zoom * 2) >= 2)
+                    zoom*= 2;
+                if ((key == SDLK_MINUS || key == SDLK_KP_MINUS) && zoom > 1)
+                    zoom/= 2;
+            }
+        }
+
+        auto now= chrono::steady_clock::now();
+        if (now - lastDrawTime >= frameInterval) {
+            lastDrawTime= now;
+
+            // frames with nothing new are skipped altogether
+            bool changed= updateLayers();
+
+            if (changed) {
+                // the texture keeps the other rows from earlier uploads
+                auto [first, last]= drawFrame();
+
+                if (!nullRender && first <= last) {
+                    SDL_Rect rows{ 0, first, windowWidth, last - first + 1 };
+                    SDL_UpdateTexture(waveformTexture, &rows, canvas.data() + static_cast<size_t>(first) * windowWidth,
+                        windowWidth * sizeof(uint32_t));
+                }
+            }
+
+            if (!nullRender && (changed || exposed)) {
+                exposed= false;
+                SDL_RenderClear(renderer);
+                SDL_RenderCopy(renderer, waveformTexture, nullptr, nullptr);
+                SDL_RenderPresent(renderer);
+            }
+        }
+
+        this_thread::sleep_for(frameInterval);
+    }
+
+    inputThread.join();
+    if (analysisThread.joinable())
+        analysisThread.join();
+
+    if (!nullRender) {
+        SDL_DestroyTexture(waveformTexture);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+    }
+    return EXIT_SUCCESS;;
+}
+
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <optional>
+#include <vector>
+#include <unistd.h>
+
+#include <argparse/argparse.hpp>
+
+#include "pacer.hpp"
+#include "patch.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args("synth");
+    args.add_argument("--chain").append().help("module chain, e.g. \"cv --duration 3 | vco --sensitivity 100 | filter --cutoff 3000\"; repeat for parallel branches");
+    args.add_argument("--patch").append().help("patch file with one module per line; repeat for parallel branches");
+    args.add_argument("--mix").help("chain applied to the sum of the branches");
+    args.add_argument("--threads").default_value(1).help("threads rendering the branches; 0 uses every core").scan<'i', int>();
+    args.add_argument("--format").default_value(string("text")).help("text | raw | f32 | f64").action([](const string &v){ parseAudioFormat(v); return v; });
+    args.add_argument("--block_size").default_value(256).help("samples processed per block").scan<'i', int>();
+    args.add_argument("--shm_in").default_value(string("")).help("read from the shared-memory ring NAME instead of stdin");
+    args.add_argument("--shm_out").default_value(string("")).help("write to the shared-memory ring NAME instead of stdout");
+    args.add_argument("--realtime").default_value(false).implicit_value(true).help("pace output to the wall clock");
+    args.add_argument("--offline").default_value(false).implicit_value(true).help("no pacing, render as fast as possible (default)");
+    args.add_argument("--clock-from-downstream").default_value(false).implicit_value(true).help("no pacing, rely on pipe backpressure");
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const exception &e) {
+        cerr << e.what() << endl << args << endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto chains= args.present<vector<string>>("chain");
+    const auto patchFiles= args.present<vector<string>>("patch");
+    const auto mix= args.present<string>("mix");
+    const auto format= parseAudioFormat(args.get<string>("format"));
+    const auto blockSize= args.get<int>("block_size");
+
+    if (!chains && !patchFiles) {
+        cerr << "at least one --chain or --patch is required" << endl << args << endl;
+        return EXIT_FAILURE;
+    }
+    if (blockSize < 1) {
+        cerr << "block_size must be at least 1" << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto pacing= parsePacing(args.get<bool>("realtime"), args.get<bool>("offline"), args.get<bool>("clock-from-downstream"), Pacer::Mode::OFFLINE);
+        vector<Patch> branches;
+        for (const auto &chain : chains.value_or(vector<string>{}))
+            branches.emplace_back(chain);
+        for (const auto &file : patchFiles.value_or(vector<string>{}))
+            branches.push_back(Patch::load(file));
+
+        Graph patch(move(branches), mix ? optional<Patch>(Patch(*mix)) : nullopt, parseThreads(args.get<int>("threads")));
+        Pacer pacer(pacing, patch.sampleRate());
+        SampleWriter writer(STDOUT_FILENO, format, patch.sampleRate(), 1, args.get<string>("shm_out"));
+        vector<double> block(blockSize);
+        size_t n;
+
+        if (patch.hasSource()) {
+            while (true) {
+                pacer.wait(block.size());
+                if ((n= patch.process(block.data(), block.size())) == 0)
+                    break;
+                writer.write(block.data(), n);
+                if (pacer.flushEachBlock())
+                    writer.flush();
+            }
+        } else {
+            // no source module: the patch processes stdin like any other stage
+            SampleReader reader(STDIN_FILENO, format, args.get<string>("shm_in"));
+            while ((n= reader.read(block.data(), block.size())) > 0) {
+                pacer.wait(n);
+                writer.write(block.data(), patch.process(block.data(), n));
+                if (pacer.flushEachBlock())
+                    writer.flush();
+            }
+        }
+
+        pacer.report("synth");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
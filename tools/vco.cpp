@@ -0,0 +1,118 @@
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+#include <argparse/argparse.hpp>
+
+#include "vco.hpp"
+#include "wavetable.hpp"
+#include "stream.hpp"
+
+using namespace std;
+
+// renders the CV of reader in blocks of Sample
+template<typename Sample>
+static void render(BasicVco<Sample> vco, SampleReader &reader, SampleWriter &writer, Vco::WaveType waveType,
+   size_t blockSize) {
+
+   vector<Sample> block(blockSize);
+   size_t n;
+
+   if (reader.control()) {
+      // control-rate CV: each run is rendered with its voltage held
+      ControlRun run;
+      while (reader.readRuns(&run, 1) > 0) {
+         for (size_t i= 0; i < run.frames; i+= n) {
+            n= min(block.size(), run.frames - i);
+            vco.generateWaveForm(run.value, block.data(), n, waveType);
+            writer.write(block.data(), n);
+         }
+      }
+   } else {
+      while ((n= reader.read(block.data(), block.size())) > 0) {
+         vco.generateWaveForm(block.data(), block.data(), n, waveType);
+         writer.write(block.data(), n);
+      }
+   }
+}
+
+int main(int argc, char *argv[]) {
+
+   double sampleRate;
+   double sensitivity;
+   double amplitude;
+
+   argparse::ArgumentParser args("Vco");
+   args.add_argument("--sensitivity").default_value(1.0).help("control voltage sensitivity").scan<'g', double>();
+   args.add_argument("--sample_rate").default_value(48000.0).help("sampling rate").scan<'g', double>();
+   args.add_argument("--amplitude").default_value(1.0).help("amplitude").scan<'g', double>();
+   args.add_argument("--wave_type").default_value(string("sine")).help("sine, triangle, square").action([](const string &value) {
+
+       if (value != "sine" && value != "triangle" && value != "square") 
+           throw runtime_error("Invalid wave type: must be 'sine', 'triangle', or 'square'");
+
+      return value;
+   });
+   args.add_argument("--format").default_value(string("text")).help("text, raw, f32, f64").action([](const string &value) {
+       parseAudioFormat(value);
+       return value;
+   });
+   args.add_argument("--engine").default_value(string("naive")).help("naive, wavetable, polyblep").action([](const string &value) {
+       parseEngine(value);
+       return value;
+   });
+   args.add_argument("--precision").default_value(string("full")).help("sine accuracy: low (1e-4), high (1e-6), full (libm)").action([](const string &value) {
+       parsePrecision(value);
+       return value;
+   });
+   args.add_argument("--sample_type").default_value(string("double")).help("double, float: the type of the processed blocks").action([](const string &value) {
+       parseProcessingType(value);
+       return value;
+   });
+   args.add_argument("--wavetable_cache").default_value(string("")).help("file to load/store the wavetables");
+   args.add_argument("--block_size").default_value(256).help("samples processed per block").scan<'i', int>();
+   args.add_argument("--shm_in").default_value(string("")).help("read from the shared-memory ring NAME instead of stdin");
+   args.add_argument("--shm_out").default_value(string("")).help("write to the shared-memory ring NAME instead of stdout");
+
+
+   try {
+       args.parse_args(argc, argv);
+   } catch (const exception &err) {
+      cerr << err.what() << endl;
+      cerr << args;
+      return EXIT_FAILURE;
+   }
+
+   sensitivity= args.get<double>("sensitivity");
+   sampleRate= args.get<double>("sample_rate");
+   amplitude= args.get<double>("amplitude");
+   Vco::WaveType waveType= parseWaveType(args.get<string>("wave_type"));
+   Format format= parseAudioFormat(args.get<string>("format"));
+   Vco::Engine engine= parseEngine(args.get<string>("engine"));
+   Precision precision= parsePrecision(args.get<string>("precision"));
+   ProcessingType sampleType= parseProcessingType(args.get<string>("sample_type"));
+   int blockSize= args.get<int>("block_size");
+
+   if (blockSize < 1) {
+      cerr << "block_size must be at least 1" << endl;
+      return EXIT_FAILURE;
+   }
+
+   if (engine == Vco::Engine::WAVETABLE)
+      WavetableSet::shared(args.get<string>("wavetable_cache"));
+
+   SampleReader reader(STDIN_FILENO, format, args.get<string>("shm_in"));
+   SampleWriter writer(STDOUT_FILENO, format, sampleRate, 1, args.get<string>("shm_out"));
+
+   try {
+      if (sampleType == ProcessingType::FLOAT)
+         render(BasicVco<float>(sampleRate, sensitivity, amplitude, engine, precision), reader, writer, waveType, blockSize);
+      else
+         render(Vco(sampleRate, sensitivity, amplitude, engine, precision), reader, writer, waveType, blockSize);
+   } catch (const exception &err) {
+      cerr << err.what() << endl;
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}